@@ -0,0 +1,381 @@
+#include "lexer.h"
+#include "token_buffer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+
+#include "memory.h"
+
+#include "workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//DOCS: the benchmark harness times each stage of the pipeline separately, on generated workloads
+typedef enum {
+	STAGE_LEX, //lexer only, or filling the token buffer with -t
+	STAGE_PARSE, //parser, including the lexer it pulls tokens from unless the tokens were buffered
+	STAGE_COMPILE,
+	STAGE_COLLATE,
+	STAGE_LOAD, //header and data section
+	STAGE_EXECUTE, //code section
+	STAGE_COUNT,
+} Stage;
+
+static const char* stageNames[STAGE_COUNT] = {
+	"lex",
+	"parse",
+	"compile",
+	"collate",
+	"load",
+	"execute",
+};
+
+typedef struct {
+	long statements;
+	long terms; //of the single deep statement, 0 for the usual workloads
+	size_t sourceLength;
+	int bytecodeSize;
+	int literalCount;
+	double seconds[STAGE_COUNT];
+} BenchResult;
+
+//nodes are parsed in batches, so the parser and compiler can be timed apart without holding the whole AST
+#define PARSE_BATCH 4096
+
+static bool buffered = false; //lex the whole source into a token buffer, then parse from it
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void silentOutput(const char* output) {
+	//discard everything, the output itself isn't being measured
+}
+
+static bool benchLexer(char* source, double* seconds) {
+	Lexer lexer;
+	initLexer(&lexer, source);
+
+	double start = now();
+
+	Token token = scanLexer(&lexer);
+	while(token.type != TOKEN_EOF) {
+		if (token.type == TOKEN_ERROR) {
+			return false;
+		}
+
+		token = scanLexer(&lexer);
+	}
+
+	*seconds = now() - start;
+	return true;
+}
+
+static void freeBufferedTokens(TokenBuffer* tokens) {
+	if (buffered) {
+		freeTokenBuffer(tokens);
+	}
+}
+
+static bool benchPipeline(char* source, BenchResult* result) {
+	Lexer lexer;
+	TokenBuffer tokens;
+	Parser parser;
+	Compiler compiler;
+	Interpreter interpreter;
+
+	NodeArray batch;
+	bool done = false;
+
+	initLexer(&lexer, source);
+
+	if (buffered) {
+		double start = now();
+		initTokenBuffer(&tokens, &lexer);
+		result->seconds[STAGE_LEX] = now() - start;
+
+		initParserTokens(&parser, &tokens);
+	}
+	else {
+		initParser(&parser, &lexer);
+	}
+
+	parser.optimize = command.optimize;
+	initCompiler(&compiler);
+	initNodeArray(&batch);
+
+	result->seconds[STAGE_PARSE] = 0;
+	result->seconds[STAGE_COMPILE] = 0;
+
+	//without optimizations the parser writes the bytecode itself, so it's all timed as parsing
+	if (parser.optimize == 0) {
+		double start = now();
+		while (!parser.error && writeParser(&parser, &compiler));
+		result->seconds[STAGE_PARSE] = now() - start;
+
+		done = true;
+
+		if (parser.error) {
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			freeBufferedTokens(&tokens);
+			return false;
+		}
+	}
+
+	while(!done) {
+		//parse a batch
+		int count = 0;
+		double start = now();
+
+		while(count < PARSE_BATCH) {
+			if (!scanParser(&parser, &batch)) {
+				done = true;
+				break;
+			}
+
+			count++;
+		}
+
+		result->seconds[STAGE_PARSE] += now() - start;
+
+		//check for errors before compiling anything
+		if (parser.error) {
+			freeNodeArray(&batch);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			freeBufferedTokens(&tokens);
+			return false;
+		}
+
+		//compile the batch, the statements are laid out one after another so it's one pass
+		start = now();
+		writeCompiler(&compiler, &batch);
+		result->seconds[STAGE_COMPILE] += now() - start;
+
+		clearNodeArray(&batch);
+	}
+
+	freeNodeArray(&batch);
+
+	result->literalCount = compiler.literalCache.count;
+
+	//collate
+	double start = now();
+	char* tb = collateCompiler(&compiler, &result->bytecodeSize);
+	result->seconds[STAGE_COLLATE] = now() - start;
+
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	freeBufferedTokens(&tokens);
+
+	//load
+	start = now();
+	initInterpreter(&interpreter, (unsigned char*)tb, result->bytecodeSize);
+	setInterpreterPrint(&interpreter, silentOutput);
+	setInterpreterAssert(&interpreter, silentOutput);
+	bool loaded = loadInterpreter(&interpreter);
+	result->seconds[STAGE_LOAD] = now() - start;
+
+	if (!loaded) {
+		freeInterpreter(&interpreter);
+		return false;
+	}
+
+	//execute
+	start = now();
+	runInterpreter(&interpreter);
+	result->seconds[STAGE_EXECUTE] = now() - start;
+
+	freeInterpreter(&interpreter);
+
+	return true;
+}
+
+//terms picks the deep workload over the usual one
+static bool runBenchmark(WorkloadOptions* options, long terms, int repetitions, BenchResult* best) {
+	const long statements = terms > 0 ? 1 : options->statements;
+	size_t length = 0;
+	char* source = terms > 0 ? generateDeepWorkload(options, terms, &length) : generateWorkload(options, &length);
+
+	//keep the fastest time of each stage
+	for (int r = 0; r < repetitions; r++) {
+		BenchResult result;
+		result.statements = statements;
+		result.terms = terms;
+		result.sourceLength = length;
+
+		//the token buffer is timed as lexing by the pipeline itself
+		if ((!buffered && !benchLexer(source, &result.seconds[STAGE_LEX])) || !benchPipeline(source, &result)) {
+			free(source);
+			return false;
+		}
+
+		if (r == 0) {
+			*best = result;
+			continue;
+		}
+
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			if (result.seconds[s] < best->seconds[s]) {
+				best->seconds[s] = result.seconds[s];
+			}
+		}
+	}
+
+	free(source);
+	return true;
+}
+
+static void writeJson(FILE* out, BenchResult* results, int count, int repetitions, unsigned long long seed) {
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"version\": \"%d.%d.%d\",\n", TOY_VERSION_MAJOR, TOY_VERSION_MINOR, TOY_VERSION_PATCH);
+	fprintf(out, "\t\"format\": %d,\n", TOY_BYTECODE_FORMAT);
+	fprintf(out, "\t\"optimize\": %d,\n", command.optimize);
+	fprintf(out, "\t\"tokens\": %s,\n", buffered ? "true" : "false");
+	fprintf(out, "\t\"repetitions\": %d,\n", repetitions);
+	fprintf(out, "\t\"seed\": %llu,\n", seed);
+	fprintf(out, "\t\"results\": [\n");
+
+	for (int i = 0; i < count; i++) {
+		fprintf(out, "\t\t{\n");
+		fprintf(out, "\t\t\t\"statements\": %ld,\n", results[i].statements);
+
+		if (results[i].terms > 0) {
+			fprintf(out, "\t\t\t\"terms\": %ld,\n", results[i].terms);
+		}
+
+		fprintf(out, "\t\t\t\"source_bytes\": %zu,\n", results[i].sourceLength);
+		fprintf(out, "\t\t\t\"bytecode_bytes\": %d,\n", results[i].bytecodeSize);
+		fprintf(out, "\t\t\t\"literals\": %d,\n", results[i].literalCount);
+		fprintf(out, "\t\t\t\"seconds\": {");
+
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			fprintf(out, "%s\"%s\": %.9f", s ? ", " : "", stageNames[s], results[i].seconds[s]);
+		}
+
+		fprintf(out, "}\n");
+		fprintf(out, "\t\t}%s\n", i + 1 < count ? "," : "");
+	}
+
+	fprintf(out, "\t]\n");
+	fprintf(out, "}\n");
+}
+
+static void usage(const char* name) {
+	printf("Usage: %s [-OX] [-r repetitions] [-S seed] [-o output.json] [-t] [-n statements]... [-x terms]...\n\n", name);
+	printf("-n statements\t\tBenchmark a workload of this many statements (repeatable, default 1k to 10M).\n");
+	printf("-x terms\t\tBenchmark one statement of this many terms, nested half as deep (repeatable).\n");
+	printf("-r repetitions\t\tKeep the fastest of this many runs (default 1).\n");
+	printf("-S seed\t\t\tSeed for the generated workloads (default 1).\n");
+	printf("-o output.json\t\tWrite the results here instead of stdout.\n");
+	printf("-t\t\t\tLex each workload into a token buffer before parsing it, so the parse stage excludes lexing.\n");
+	printf("-OX\t\t\tUse level X optimization (default 1), at 0 the parse stage includes compiling.\n");
+}
+
+int main(int argc, const char* argv[]) {
+	long sizes[64];
+	long terms[64]; //0 for the usual workloads
+	int sizeCount = 0;
+	int repetitions = 1;
+	const char* outputName = NULL;
+	WorkloadOptions options;
+
+	initCommand(1, argv); //defaults only
+	initWorkloadOptions(&options);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc && sizeCount < 64) {
+			terms[sizeCount] = 0;
+			sizes[sizeCount++] = atol(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-x") && i + 1 < argc && sizeCount < 64) {
+			sizes[sizeCount] = 1;
+			terms[sizeCount++] = atol(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			repetitions = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-S") && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-t")) {
+			buffered = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			outputName = argv[++i];
+			continue;
+		}
+
+		if (!strncmp(argv[i], "-O", 2)) {
+			sscanf(argv[i], "-O%d", &command.optimize);
+			continue;
+		}
+
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (sizeCount == 0) {
+		for (long n = 1000; n <= 10000000; n *= 10) {
+			terms[sizeCount] = 0;
+			sizes[sizeCount++] = n;
+		}
+	}
+
+	if (repetitions < 1) {
+		repetitions = 1;
+	}
+
+	BenchResult results[64];
+
+	for (int i = 0; i < sizeCount; i++) {
+		options.statements = sizes[i];
+
+		if (!runBenchmark(&options, terms[i], repetitions, &results[i])) {
+			fprintf(stderr, "Benchmark failed for %ld %s\n", terms[i] > 0 ? terms[i] : sizes[i], terms[i] > 0 ? "terms" : "statements");
+			return -1;
+		}
+
+		//progress on stderr, so stdout stays machine-readable
+		fprintf(stderr, "%10ld %s:", terms[i] > 0 ? terms[i] : sizes[i], terms[i] > 0 ? "terms" : "statements");
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			fprintf(stderr, " %s %.3fms", stageNames[s], results[i].seconds[s] * 1000);
+		}
+		fprintf(stderr, "\n");
+	}
+
+	FILE* out = stdout;
+
+	if (outputName) {
+		out = fopen(outputName, "w");
+
+		if (out == NULL) {
+			fprintf(stderr, "Could not open file \"%s\"\n", outputName);
+			return -1;
+		}
+	}
+
+	writeJson(out, results, sizeCount, repetitions, options.seed);
+
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include "workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char* name) {
+	printf("Usage: %s [options] [-o output.toy]\n\n", name);
+	printf("-n statements\t\tNumber of statements to generate (default 1000).\n");
+	printf("-d depth\t\tMaximum expression depth (default 3).\n");
+	printf("-c cardinality\t\tDistinct values of each literal type (default 256).\n");
+	printf("-s min:max\t\tString length range (default 4:32).\n");
+	printf("-k\t\t\tSkew string lengths towards the minimum, with a long tail.\n");
+	printf("-m density\t\tChance of a comment before each statement (default 0.1).\n");
+	printf("-g nesting\t\tMaximum nesting of groupings (default 2).\n");
+	printf("-S seed\t\t\tSeed for the generator (default 1).\n");
+	printf("-o output.toy\t\tWrite the corpus here instead of stdout.\n");
+}
+
+int main(int argc, const char* argv[]) {
+	WorkloadOptions options;
+	const char* outputName = NULL;
+
+	initWorkloadOptions(&options);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			options.statements = atol(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			options.depth = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+			options.cardinality = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-s") && i + 1 < argc && sscanf(argv[i + 1], "%d:%d", &options.stringMin, &options.stringMax) == 2) {
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-k")) {
+			options.strings = STRINGS_SKEWED;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+			options.comments = atof(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+			options.nesting = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-S") && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			outputName = argv[++i];
+			continue;
+		}
+
+		usage(argv[0]);
+		return -1;
+	}
+
+	FILE* out = stdout;
+
+	if (outputName) {
+		out = fopen(outputName, "w");
+
+		if (out == NULL) {
+			fprintf(stderr, "Could not open file \"%s\"\n", outputName);
+			return -1;
+		}
+	}
+
+	//stream the corpus out, so the size isn't bounded by memory
+	Workload workload;
+	initWorkload(&workload, &options);
+
+	while (stepWorkload(&workload)) {
+		if (workload.count >= 1 << 16) {
+			fwrite(workload.buffer, 1, workload.count, out);
+			workload.count = 0;
+		}
+	}
+
+	fwrite(workload.buffer, 1, workload.count, out);
+	freeWorkload(&workload);
+
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	return 0;
+}
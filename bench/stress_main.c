@@ -0,0 +1,342 @@
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+#include "program.h"
+#include "parallel.h"
+
+#include "workload.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//DOCS: the stress test runs many whole pipelines at once, and checks each one prints exactly what a lone run printed
+//build it with "make stress", which instruments everything with ThreadSanitizer so any data race is reported as well
+typedef struct {
+	int threads;
+	int rounds; //pipelines per thread
+	long statements; //per pipeline
+	unsigned long long seed;
+} StressOptions;
+
+//big enough that writeParallel splits it into several chunks, whatever the number of jobs
+#define STRESS_CORPUS_BYTES (256 * 1024)
+
+typedef struct {
+	StressOptions* options;
+	unsigned long long* expected; //per workload
+	Program* shared; //run by every thread, alongside its own pipelines
+	unsigned long long sharedExpected;
+	char* corpus; //compiled once by every thread, across a pool of its own
+	size_t corpusLength;
+	unsigned long long corpusExpected;
+	int index;
+	int failures;
+} StressWorker;
+
+//the output of the calling thread's interpreter is folded into this, FNV-1a
+static _Thread_local unsigned long long outputHash;
+
+static void hashOutput(const char* output) {
+	for (const char* c = output; *c; c++) {
+		outputHash = (outputHash ^ (unsigned char)*c) * 0x100000001b3ull;
+	}
+
+	outputHash = (outputHash ^ '\n') * 0x100000001b3ull;
+}
+
+static char* generateSource(StressOptions* options, int workload, long statements, size_t* length) {
+	WorkloadOptions workloadOptions;
+	initWorkloadOptions(&workloadOptions);
+	workloadOptions.seed = options->seed + workload;
+	workloadOptions.statements = statements;
+
+	return generateWorkload(&workloadOptions, length);
+}
+
+//every stage by hand, the way the toy executable does it, returns false on a parse error
+//lines marks each statement's line, for the debug section
+static bool compileSequential(Compiler* compiler, char* source, size_t length, int optimize, bool lines) {
+	Lexer lexer;
+	Parser parser;
+
+	initLexerLength(&lexer, source, length);
+	initParser(&parser, &lexer);
+	parser.optimize = optimize;
+
+	//without optimizations the parser writes the bytecode itself
+	if (optimize == 0) {
+		while (!parser.error) {
+			if (lines && parser.current.type != TOKEN_EOF) {
+				markCompilerLine(compiler, findParserLine(&parser, parser.current));
+			}
+
+			if (!writeParser(&parser, compiler)) {
+				break;
+			}
+		}
+	}
+	else {
+		NodeArray nodes;
+		initNodeArray(&nodes);
+
+		while(scanParser(&parser, &nodes) && !parser.error) {
+			if (lines) {
+				markCompilerLine(compiler, findParserLine(&parser, parser.statement));
+			}
+
+			writeCompiler(compiler, &nodes);
+			clearNodeArray(&nodes);
+		}
+
+		freeNodeArray(&nodes);
+	}
+
+	bool error = parser.error;
+	freeParser(&parser);
+
+	return !error;
+}
+
+//collate what was compiled, then load it back and run it, the compiler is freed
+static unsigned long long runCompiler(Compiler* compiler) {
+	Interpreter interpreter;
+
+	int size = 0;
+	char* tb = collateCompiler(compiler, &size);
+	freeCompiler(compiler);
+
+	initInterpreter(&interpreter, (unsigned char*)tb, size);
+	setInterpreterPrint(&interpreter, hashOutput);
+	setInterpreterAssert(&interpreter, hashOutput);
+	setInterpreterError(&interpreter, hashOutput);
+
+	outputHash = 0xcbf29ce484222325ull;
+	runInterpreter(&interpreter);
+	freeInterpreter(&interpreter);
+
+	return outputHash;
+}
+
+static unsigned long long runPipeline(char* source, size_t length, int optimize) {
+	Compiler compiler;
+	initCompiler(&compiler);
+
+	if (!compileSequential(&compiler, source, length, optimize, false)) {
+		freeCompiler(&compiler);
+		return 0;
+	}
+
+	return runCompiler(&compiler);
+}
+
+//the same, but split across a pool of this many jobs
+static unsigned long long runParallel(char* source, size_t length, int optimize, int jobs) {
+	Compiler compiler;
+	initCompiler(&compiler);
+
+	if (!writeParallel(&compiler, source, length, optimize, false, jobs)) {
+		freeCompiler(&compiler);
+		return 0;
+	}
+
+	return runCompiler(&compiler);
+}
+
+static unsigned long long runShared(Program* program) {
+	Interpreter interpreter;
+
+	bindProgram(program, &interpreter);
+	setInterpreterPrint(&interpreter, hashOutput);
+	setInterpreterAssert(&interpreter, hashOutput);
+	setInterpreterError(&interpreter, hashOutput);
+
+	outputHash = 0xcbf29ce484222325ull;
+	runInterpreter(&interpreter);
+	freeInterpreter(&interpreter);
+
+	return outputHash;
+}
+
+//the parallel compile must collate to exactly the same bytes as the sequential one, with and without the line table, returns the number of mismatches
+static int checkParallel(char* source, size_t length) {
+	int failures = 0;
+
+	for (int optimize = 0; optimize <= 1; optimize++) {
+		for (int lines = 0; lines <= 1; lines++) {
+			Compiler compiler;
+			initCompiler(&compiler);
+			bool compiled = compileSequential(&compiler, source, length, optimize, lines);
+
+			int expectedSize = 0;
+			char* expected = collateCompiler(&compiler, &expectedSize);
+			freeCompiler(&compiler);
+
+			if (!compiled) {
+				fprintf(stderr, "Could not compile the corpus at -O%d\n", optimize);
+				free(expected);
+				return failures + 1;
+			}
+
+			for (int jobs = 2; jobs <= 8; jobs++) {
+				initCompiler(&compiler);
+				compiled = writeParallel(&compiler, source, length, optimize, lines, jobs);
+
+				int size = 0;
+				char* tb = collateCompiler(&compiler, &size);
+				freeCompiler(&compiler);
+
+				if (!compiled || size != expectedSize || memcmp(tb, expected, size) != 0) {
+					fprintf(stderr, "The corpus compiled with %d jobs at -O%d%s differs from the sequential bytecode\n", jobs, optimize, lines ? " with lines" : "");
+					failures++;
+				}
+
+				free(tb);
+			}
+
+			free(expected);
+		}
+	}
+
+	return failures;
+}
+
+static void* runWorker(void* arg) {
+	StressWorker* worker = (StressWorker*)arg;
+	StressOptions* options = worker->options;
+
+	//pools of every size from 2 to 8, at both optimization levels, all running at once
+	if (runParallel(worker->corpus, worker->corpusLength, worker->index % 2, 2 + worker->index % 7) != worker->corpusExpected) {
+		fprintf(stderr, "Thread %d: the corpus compiled in parallel printed something different\n", worker->index);
+		worker->failures++;
+	}
+
+	for (int r = 0; r < options->rounds; r++) {
+		//each thread walks the workloads from a different starting point, to mix the optimization levels
+		int workload = (worker->index + r) % options->rounds;
+		int optimize = workload % 2;
+
+		size_t length = 0;
+		char* source = generateSource(options, workload, options->statements, &length);
+
+		if (runPipeline(source, length, optimize) != worker->expected[workload]) {
+			fprintf(stderr, "Thread %d: workload %d printed something different\n", worker->index, workload);
+			worker->failures++;
+		}
+
+		free(source);
+
+		if (runShared(worker->shared) != worker->sharedExpected) {
+			fprintf(stderr, "Thread %d: the shared program printed something different\n", worker->index);
+			worker->failures++;
+		}
+	}
+
+	return NULL;
+}
+
+static void usage(const char* name) {
+	printf("Usage: %s [-t threads] [-r rounds] [-n statements] [-S seed]\n\n", name);
+	printf("-t threads\t\tRun this many threads at once (default 8).\n");
+	printf("-r rounds\t\tRun this many pipelines on each thread (default 32).\n");
+	printf("-n statements\t\tGenerate this many statements for each pipeline (default 500).\n");
+	printf("-S seed\t\t\tSeed for the generated workloads (default 1).\n");
+}
+
+int main(int argc, const char* argv[]) {
+	StressOptions options = { 8, 32, 500, 1 };
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			options.rounds = atoi(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			options.statements = atol(argv[++i]);
+			continue;
+		}
+
+		if (!strcmp(argv[i], "-S") && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+			continue;
+		}
+
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (options.threads < 1 || options.rounds < 1 || options.statements < 1) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	//the expected output of each workload, from a lone run
+	unsigned long long* expected = malloc(sizeof(unsigned long long) * options.rounds);
+
+	for (int w = 0; w < options.rounds; w++) {
+		size_t length = 0;
+		char* source = generateSource(&options, w, options.statements, &length);
+		expected[w] = runPipeline(source, length, w % 2);
+		free(source);
+	}
+
+	size_t sharedLength = 0;
+	char* sharedSource = generateSource(&options, options.rounds, options.statements, &sharedLength);
+	Program* shared = compileProgram(sharedSource, 1);
+	free(sharedSource);
+
+	if (shared == NULL) {
+		fprintf(stderr, "Could not compile the shared program\n");
+		return -1;
+	}
+
+	unsigned long long sharedExpected = runShared(shared);
+
+	//grow the corpus until it's worth splitting
+	size_t corpusLength = 0;
+	char* corpus = NULL;
+
+	for (long statements = options.statements; corpusLength < STRESS_CORPUS_BYTES; statements *= 2) {
+		free(corpus);
+		corpus = generateSource(&options, options.rounds + 1, statements, &corpusLength);
+	}
+
+	unsigned long long corpusExpected[2] = {
+		runPipeline(corpus, corpusLength, 0),
+		runPipeline(corpus, corpusLength, 1),
+	};
+
+	//now all at once
+	pthread_t* threads = malloc(sizeof(pthread_t) * options.threads);
+	StressWorker* workers = malloc(sizeof(StressWorker) * options.threads);
+
+	for (int i = 0; i < options.threads; i++) {
+		workers[i] = (StressWorker){ &options, expected, shared, sharedExpected, corpus, corpusLength, corpusExpected[i % 2], i, 0 };
+		pthread_create(&threads[i], NULL, runWorker, &workers[i]);
+	}
+
+	int failures = checkParallel(corpus, corpusLength);
+
+	for (int i = 0; i < options.threads; i++) {
+		pthread_join(threads[i], NULL);
+		failures += workers[i].failures;
+	}
+
+	fprintf(stderr, "%d threads, %d pipelines each, %d mismatches\n", options.threads, options.rounds * 2 + 1, failures);
+
+	freeProgram(shared);
+	free(corpus);
+	free(workers);
+	free(threads);
+	free(expected);
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+#include "workload.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//splitmix64, so the output is identical on every platform
+static unsigned long long nextRandom(unsigned long long* state) {
+	unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static int randomRange(unsigned long long* state, int lo, int hi) {
+	if (hi <= lo) {
+		return lo;
+	}
+
+	return lo + (int)(nextRandom(state) % (unsigned long long)(hi - lo + 1));
+}
+
+static bool randomChance(unsigned long long* state, double chance) {
+	return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0) < chance;
+}
+
+static void append(Workload* workload, const char* format, ...) {
+	va_list args;
+
+	for (;;) {
+		const size_t available = workload->capacity - workload->count;
+
+		va_start(args, format);
+		int written = vsnprintf(workload->buffer + workload->count, available, format, args);
+		va_end(args);
+
+		if (written >= 0 && (size_t)written < available) {
+			workload->count += written;
+			return;
+		}
+
+		//grow and try again
+		workload->capacity = workload->capacity < 4096 ? 4096 : workload->capacity * 2;
+		workload->buffer = realloc(workload->buffer, workload->capacity);
+
+		if (workload->buffer == NULL) {
+			fprintf(stderr, "Not enough memory to generate the workload\n");
+			exit(-1);
+		}
+	}
+}
+
+//literal values depend only on the seed and their index, so the cardinality holds across the whole corpus
+static int integerLiteral(Workload* workload, int index) {
+	unsigned long long state = workload->options.seed ^ ((unsigned long long)index * 0xD1B54A32D192ED03ULL);
+	return (int)(nextRandom(&state) % 100000);
+}
+
+//the largest magnitude an expression's text can reach, as the parser groups it, so integer arithmetic never overflows
+//the text is split into terms joined by + and -, and only the first and last can join with a neighbour's * / or %
+typedef struct Bound {
+	double first;
+	double middle; //every term between the first and last
+	double last;
+	bool single; //one term, which is both the first and last
+} Bound;
+
+static Bound singleBound(double value) {
+	//a factor of 0 would hide the ones multiplied before it
+	return (Bound){ value < 1 ? 1 : value, 0, value < 1 ? 1 : value, true };
+}
+
+static double totalBound(Bound bound) {
+	return bound.single ? bound.first : bound.first + bound.middle + bound.last;
+}
+
+static Bound joinBound(Bound left, char op, Bound right) {
+	//+ and - keep the terms apart
+	if (op == '+' || op == '-') {
+		return (Bound){ left.first, totalBound(left) - left.first + totalBound(right) - right.last, right.last, false };
+	}
+
+	//the right of / and % is a single literal, which can only shrink an integer
+	const double joined = op == '*' ? left.last * right.first : left.last;
+
+	if (left.single && right.single) {
+		return singleBound(joined);
+	}
+
+	if (left.single) {
+		return (Bound){ joined, right.middle, right.last, false };
+	}
+
+	if (right.single) {
+		return (Bound){ left.first, left.middle, joined, false };
+	}
+
+	return (Bound){ left.first, left.middle + joined + right.middle, right.last, false };
+}
+
+static Bound writeInteger(Workload* workload, bool nonzero) {
+	int value = integerLiteral(workload, randomRange(&workload->state, 0, workload->options.cardinality - 1));
+
+	if (nonzero && value == 0) {
+		value = 1;
+	}
+
+	append(workload, "%d", value);
+	return singleBound(value);
+}
+
+static Bound writeFloat(Workload* workload) {
+	int value = integerLiteral(workload, randomRange(&workload->state, 0, workload->options.cardinality - 1));
+	append(workload, "%d.%d", value / 10, value % 10 + 1); //never zero
+	return singleBound(value / 10 + 1);
+}
+
+static void writeString(Workload* workload) {
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789 ";
+
+	int index = randomRange(&workload->state, 0, workload->options.cardinality - 1);
+	unsigned long long state = workload->options.seed ^ ((unsigned long long)index * 0x9E3779B97F4A7C15ULL) ^ 0x5354524953ULL;
+
+	int length = 0;
+	switch(workload->options.strings) {
+		case STRINGS_UNIFORM:
+			length = randomRange(&state, workload->options.stringMin, workload->options.stringMax);
+		break;
+
+		case STRINGS_SKEWED:
+			//geometric, halving the chance of each extra character block
+			length = workload->options.stringMin;
+			while (length < workload->options.stringMax && randomChance(&state, 0.5)) {
+				length += 1 + (workload->options.stringMax - workload->options.stringMin) / 8;
+			}
+
+			if (length > workload->options.stringMax) {
+				length = workload->options.stringMax;
+			}
+		break;
+	}
+
+	append(workload, "\"");
+
+	for (int i = 0; i < length; i++) {
+		append(workload, "%c", alphabet[nextRandom(&state) % (sizeof(alphabet) - 1)]);
+	}
+
+	append(workload, "\"");
+}
+
+static Bound writeOperand(Workload* workload, bool integral) {
+	//negation is only valid directly on literals, so keep it grouped
+	bool negate = randomChance(&workload->state, 0.1);
+
+	if (negate) {
+		append(workload, "(-");
+	}
+
+	Bound bound;
+
+	if (!integral && randomChance(&workload->state, 0.3)) {
+		bound = writeFloat(workload);
+	}
+	else {
+		bound = writeInteger(workload, false);
+	}
+
+	if (negate) {
+		append(workload, ")");
+	}
+
+	return bound;
+}
+
+//integral expressions only hold integers, so modulo is always valid however the text is re-associated
+static Bound writeExpression(Workload* workload, int depth, int nesting, bool integral) {
+	if (depth <= 0 || randomChance(&workload->state, 0.3)) {
+		return writeOperand(workload, integral);
+	}
+
+	if (nesting > 0 && randomChance(&workload->state, 0.25)) {
+		append(workload, "(");
+		Bound inner = writeExpression(workload, depth - 1, nesting - 1, integral);
+		append(workload, ")");
+		return singleBound(totalBound(inner));
+	}
+
+	const char* operators = integral ? "+-*/%" : "+-*/";
+	const char op = operators[randomRange(&workload->state, 0, (int)strlen(operators) - 1)];
+
+	Bound left = writeExpression(workload, depth - 1, nesting, integral);
+	const size_t mark = workload->count;
+	append(workload, " %c ", op);
+
+	Bound right;
+
+	//the right hand side of division binds to a single literal, which must never be zero
+	if (op == '/' || op == '%') {
+		if (!integral && randomChance(&workload->state, 0.5)) {
+			right = writeFloat(workload);
+		}
+		else {
+			right = writeInteger(workload, true);
+		}
+	}
+	else {
+		right = writeExpression(workload, depth - 1, nesting, integral);
+	}
+
+	Bound joined = joinBound(left, op, right);
+
+	//overflow is undefined, so the right hand side is dropped rather than risk it
+	if (totalBound(joined) > INT_MAX) {
+		workload->count = mark;
+		workload->buffer[mark] = '\0';
+		return left;
+	}
+
+	return joined;
+}
+
+static void writeComment(Workload* workload) {
+	if (randomChance(&workload->state, 0.5)) {
+		append(workload, "//comment %d\n", randomRange(&workload->state, 0, 9999));
+	}
+	else {
+		append(workload, "/* block\n comment %d */\n", randomRange(&workload->state, 0, 9999));
+	}
+}
+
+//exposed functions
+void initWorkloadOptions(WorkloadOptions* options) {
+	options->seed = 1;
+	options->statements = 1000;
+	options->depth = 3;
+	options->cardinality = 256;
+	options->stringMin = 4;
+	options->stringMax = 32;
+	options->strings = STRINGS_UNIFORM;
+	options->comments = 0.1;
+	options->nesting = 2;
+}
+
+void initWorkload(Workload* workload, WorkloadOptions* options) {
+	workload->options = *options;
+	workload->state = options->seed;
+	workload->emitted = 0;
+
+	workload->buffer = NULL;
+	workload->capacity = 0;
+	workload->count = 0;
+
+	//sanitize
+	if (workload->options.cardinality < 1) {
+		workload->options.cardinality = 1;
+	}
+
+	if (workload->options.stringMin < 0) {
+		workload->options.stringMin = 0;
+	}
+
+	if (workload->options.stringMax < workload->options.stringMin) {
+		workload->options.stringMax = workload->options.stringMin;
+	}
+}
+
+bool stepWorkload(Workload* workload) {
+	if (workload->emitted >= workload->options.statements) {
+		return false;
+	}
+
+	if (randomChance(&workload->state, workload->options.comments)) {
+		writeComment(workload);
+	}
+
+	const int kind = randomRange(&workload->state, 0, 15);
+
+	if (kind == 0) {
+		//asserts must pass, or execution stops
+		append(workload, "assert true, ");
+		writeString(workload);
+		append(workload, ";\n");
+	}
+	else if (kind == 1) {
+		static const char* atoms[] = { "null", "true", "false" };
+		append(workload, "print %s;\n", atoms[randomRange(&workload->state, 0, 2)]);
+	}
+	else if (kind <= 4) {
+		append(workload, "print ");
+		writeString(workload);
+		append(workload, ";\n");
+	}
+	else {
+		append(workload, "print ");
+		writeExpression(workload, workload->options.depth, workload->options.nesting, randomChance(&workload->state, 0.5));
+		append(workload, ";\n");
+	}
+
+	workload->emitted++;
+	return true;
+}
+
+void freeWorkload(Workload* workload) {
+	free(workload->buffer);
+	workload->buffer = NULL;
+	workload->capacity = 0;
+	workload->count = 0;
+}
+
+char* generateWorkload(WorkloadOptions* options, size_t* length) {
+	Workload workload;
+	initWorkload(&workload, options);
+
+	append(&workload, ""); //ensure the buffer exists, even when empty
+
+	while (stepWorkload(&workload));
+
+	*length = workload.count;
+	return workload.buffer; //handed to the caller
+}
+
+char* generateDeepWorkload(WorkloadOptions* options, long terms, size_t* length) {
+	Workload workload;
+	initWorkload(&workload, options);
+
+	append(&workload, "print ");
+
+	long depth = 0;
+
+	//single digits added and subtracted, so folding never overflows
+	for (long i = 0; i < terms; i++) {
+		const int digit = randomRange(&workload.state, 1, 9);
+
+		if (i + 1 == terms) {
+			append(&workload, "%d", digit);
+			break;
+		}
+
+		const char op = randomChance(&workload.state, 0.5) ? '+' : '-';
+
+		if (i % 2) {
+			append(&workload, "%d %c (", digit, op);
+			depth++;
+		}
+		else {
+			append(&workload, "%d %c ", digit, op);
+		}
+	}
+
+	//close the groupings in blocks
+	char block[256];
+	memset(block, ')', sizeof(block) - 1);
+	block[sizeof(block) - 1] = '\0';
+
+	for (; depth >= (long)sizeof(block) - 1; depth -= sizeof(block) - 1) {
+		append(&workload, "%s", block);
+	}
+
+	append(&workload, "%.*s;\n", (int)depth, block);
+
+	*length = workload.count;
+	return workload.buffer; //handed to the caller
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+//DOCS: workloads are deterministic, seeded corpora of toy source, shaped to resemble production scripts
+
+typedef enum WorkloadStrings {
+	STRINGS_UNIFORM, //lengths evenly spread between the minimum and maximum
+	STRINGS_SKEWED, //mostly short strings, with a long tail up to the maximum
+} WorkloadStrings;
+
+typedef struct WorkloadOptions {
+	unsigned long long seed;
+	long statements;
+	int depth; //maximum depth of each expression tree
+	int cardinality; //number of distinct values for each literal type
+	int stringMin;
+	int stringMax;
+	WorkloadStrings strings;
+	double comments; //chance of a comment before each statement
+	int nesting; //maximum nesting of groupings within an expression
+} WorkloadOptions;
+
+typedef struct Workload {
+	WorkloadOptions options;
+	unsigned long long state;
+	long emitted;
+
+	//the text generated so far, the caller may drain it between steps
+	char* buffer;
+	size_t capacity;
+	size_t count;
+} Workload;
+
+void initWorkloadOptions(WorkloadOptions* options);
+
+void initWorkload(Workload* workload, WorkloadOptions* options);
+bool stepWorkload(Workload* workload); //appends the next statement, false once all have been emitted
+void freeWorkload(Workload* workload);
+
+//generate the whole corpus at once, the caller must free() the result
+char* generateWorkload(WorkloadOptions* options, size_t* length);
+
+//one statement of this many terms, with every other term a grouping deeper than the last, so nothing that recurses on it survives
+//the caller must free() the result
+char* generateDeepWorkload(WorkloadOptions* options, long terms, size_t* length);
@@ -0,0 +1,327 @@
+#include "batch.h"
+
+#include "program.h"
+
+#include "memory.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//the script being run by the calling thread, for the output callbacks
+static _Thread_local BatchScript* capturing = NULL;
+
+static double readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void writeBuffer(BatchBuffer* buffer, const char* str) {
+	int length = strlen(str);
+
+	if (buffer->capacity < buffer->count + length) {
+		int oldCapacity = buffer->capacity;
+
+		while (buffer->capacity < buffer->count + length) {
+			buffer->capacity = GROW_CAPACITY(buffer->capacity);
+		}
+
+		buffer->data = GROW_ARRAY(char, buffer->data, oldCapacity, buffer->capacity);
+	}
+
+	memcpy(&buffer->data[buffer->count], str, length);
+	buffer->count += length;
+}
+
+static void freeBuffer(BatchBuffer* buffer) {
+	FREE_ARRAY(char, buffer->data, buffer->capacity);
+	buffer->data = NULL;
+	buffer->capacity = 0;
+	buffer->count = 0;
+}
+
+static void printCapture(const char* output) {
+	writeBuffer(&capturing->out, output);
+	writeBuffer(&capturing->out, "\n");
+}
+
+static void assertCapture(const char* output) {
+	writeBuffer(&capturing->err, "Assertion failure: ");
+	writeBuffer(&capturing->err, output);
+	writeBuffer(&capturing->err, "\n");
+	capturing->failed = true;
+}
+
+static void errorCapture(const char* output) {
+	writeBuffer(&capturing->err, output); //parser and interpreter errors end in their own new line
+}
+
+//returns NULL if it can't be read, free it with FREE_ARRAY(char, buffer, size + 1)
+static char* readSource(char* path, int* size) {
+	FILE* file = fopen(path, "rb");
+
+	if (file == NULL) {
+		return NULL;
+	}
+
+	fseek(file, 0L, SEEK_END);
+	*size = ftell(file);
+	rewind(file);
+
+	char* buffer = ALLOCATE(char, *size + 1);
+
+	if (fread(buffer, sizeof(char), *size, file) < (size_t)*size) {
+		FREE_ARRAY(char, buffer, *size + 1);
+		fclose(file);
+		return NULL;
+	}
+
+	fclose(file);
+
+	buffer[*size] = '\0';
+
+	return buffer;
+}
+
+static void runScript(BatchScript* script, int index, int optimize, InterpreterLimits* limits) {
+	TRACE_BEGIN_VALUE("batch", "script", "index", index);
+	double start = readClock();
+
+	int size = 0;
+	char* source = readSource(script->path, &size);
+
+	if (source == NULL) {
+		writeBuffer(&script->err, "Could not read file \"");
+		writeBuffer(&script->err, script->path);
+		writeBuffer(&script->err, "\"\n");
+		script->failed = true;
+		script->seconds = readClock() - start;
+		TRACE_END("batch", "script");
+		return;
+	}
+
+	capturing = script;
+	Program* program = compileProgramLength(source, size, optimize, errorCapture);
+	capturing = NULL;
+	FREE_ARRAY(char, source, size + 1);
+
+	if (program == NULL) {
+		writeBuffer(&script->err, "Could not compile \"");
+		writeBuffer(&script->err, script->path);
+		writeBuffer(&script->err, "\"\n");
+		script->failed = true;
+		script->seconds = readClock() - start;
+		TRACE_END("batch", "script");
+		return;
+	}
+
+	Interpreter interpreter;
+
+	bindProgram(program, &interpreter);
+	setInterpreterPrint(&interpreter, printCapture);
+	setInterpreterAssert(&interpreter, assertCapture);
+	setInterpreterError(&interpreter, errorCapture);
+	interpreter.limits = *limits;
+
+	capturing = script;
+	runInterpreter(&interpreter);
+	capturing = NULL;
+
+	const char* stopped = describeInterpreterStatus(interpreter.status);
+
+	if (stopped) {
+		writeBuffer(&script->err, stopped);
+		writeBuffer(&script->err, " in \"");
+		writeBuffer(&script->err, script->path);
+		writeBuffer(&script->err, "\"\n");
+	}
+
+	script->failed |= interpreter.status != INTERPRETER_DONE;
+
+	freeInterpreter(&interpreter);
+	freeProgram(program);
+
+	script->seconds = readClock() - start;
+	TRACE_END("batch", "script");
+}
+
+static void* runWorker(void* arg) {
+	Batch* batch = (Batch*)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		int index = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+
+		if (index >= batch->count) {
+			return NULL;
+		}
+
+		runScript(&batch->scripts[index], index, batch->optimize, &batch->limits);
+
+		pthread_mutex_lock(&batch->lock);
+		batch->scripts[index].done = true;
+		pthread_cond_broadcast(&batch->finished);
+		pthread_mutex_unlock(&batch->lock);
+	}
+}
+
+void initBatch(Batch* batch) {
+	batch->scripts = NULL;
+	batch->capacity = 0;
+	batch->count = 0;
+	batch->next = 0;
+	batch->optimize = 1;
+	batch->limits = (InterpreterLimits){ 0, 0, 0, 0 };
+
+	pthread_mutex_init(&batch->lock, NULL);
+	pthread_cond_init(&batch->finished, NULL);
+}
+
+void freeBatch(Batch* batch) {
+	for (int i = 0; i < batch->count; i++) {
+		FREE_ARRAY(char, batch->scripts[i].path, strlen(batch->scripts[i].path) + 1);
+		freeBuffer(&batch->scripts[i].out);
+		freeBuffer(&batch->scripts[i].err);
+	}
+
+	FREE_ARRAY(BatchScript, batch->scripts, batch->capacity);
+	batch->scripts = NULL;
+	batch->capacity = 0;
+	batch->count = 0;
+
+	pthread_mutex_destroy(&batch->lock);
+	pthread_cond_destroy(&batch->finished);
+}
+
+static void pushScript(Batch* batch, char* path, int length) {
+	if (batch->capacity < batch->count + 1) {
+		int oldCapacity = batch->capacity;
+
+		batch->capacity = GROW_CAPACITY(oldCapacity);
+		batch->scripts = GROW_ARRAY(BatchScript, batch->scripts, oldCapacity, batch->capacity);
+	}
+
+	BatchScript* script = &batch->scripts[batch->count++];
+
+	script->path = copyString(path, length);
+	script->out = (BatchBuffer){ NULL, 0, 0 };
+	script->err = (BatchBuffer){ NULL, 0, 0 };
+	script->failed = false;
+	script->done = false;
+	script->seconds = 0;
+}
+
+bool pushBatch(Batch* batch, char* path) {
+	if (path[0] != '@') {
+		pushScript(batch, path, strlen(path));
+		return true;
+	}
+
+	//read the manifest
+	int size = 0;
+	char* manifest = readSource(path + 1, &size);
+
+	if (manifest == NULL) {
+		return false;
+	}
+
+	int start = 0;
+	for (int i = 0; i <= size; i++) {
+		if (i < size && manifest[i] != '\n') {
+			continue;
+		}
+
+		//trim windows line endings
+		int end = i;
+		if (end > start && manifest[end - 1] == '\r') {
+			end--;
+		}
+
+		if (end > start) {
+			pushScript(batch, &manifest[start], end - start);
+		}
+
+		start = i + 1;
+	}
+
+	FREE_ARRAY(char, manifest, size + 1);
+
+	return true;
+}
+
+int runBatch(Batch* batch, int jobs) {
+	if (jobs <= 0) {
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	if (jobs > batch->count) {
+		jobs = batch->count;
+	}
+
+	double start = readClock();
+
+	pthread_t* workers = ALLOCATE(pthread_t, jobs);
+
+	for (int i = 0; i < jobs; i++) {
+		pthread_create(&workers[i], NULL, runWorker, batch);
+	}
+
+	//write each script's output in order, while later scripts are still running
+	int failures = 0;
+	int slowest = 0;
+	double total = 0;
+
+	for (int i = 0; i < batch->count; i++) {
+		BatchScript* script = &batch->scripts[i];
+
+		pthread_mutex_lock(&batch->lock);
+		while (!script->done) {
+			pthread_cond_wait(&batch->finished, &batch->lock);
+		}
+		pthread_mutex_unlock(&batch->lock);
+
+		fwrite(script->out.data, sizeof(char), script->out.count, stdout);
+
+		if (script->err.count > 0) {
+			fflush(stdout); //keep each script's errors after its output when both streams share a console
+			fwrite(script->err.data, sizeof(char), script->err.count, stderr);
+		}
+
+		freeBuffer(&script->out);
+		freeBuffer(&script->err);
+
+		failures += script->failed;
+		total += script->seconds;
+
+		if (script->seconds > batch->scripts[slowest].seconds) {
+			slowest = i;
+		}
+	}
+
+	for (int i = 0; i < jobs; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	FREE_ARRAY(pthread_t, workers, jobs);
+
+	//summary
+	fflush(stdout);
+
+	if (batch->count > 0) {
+		fprintf(stderr, "Batch: %d scripts, %d failed, %d jobs, %.3fms wall, %.3fms total, slowest %.3fms (%s)\n",
+			batch->count,
+			failures,
+			jobs,
+			(readClock() - start) * 1e3,
+			total * 1e3,
+			batch->scripts[slowest].seconds * 1e3,
+			batch->scripts[slowest].path
+		);
+	}
+
+	return failures;
+}
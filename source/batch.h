@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+#include "interpreter.h"
+
+#include <pthread.h>
+
+//DOCS: a batch runs many scripts across a pool of worker threads, each script getting its own program and interpreter
+//the output of every script is captured, then written in the order the scripts were given, as soon as it's that script's turn
+//diagnostics from the parser and the interpreter are captured with the rest, so they stay next to the script that caused them
+typedef struct BatchBuffer {
+	char* data;
+	int capacity;
+	int count;
+} BatchBuffer;
+
+typedef struct BatchScript {
+	char* path;
+	BatchBuffer out; //print
+	BatchBuffer err; //assert, parser, runtime and load failures
+	bool failed;
+	bool done;
+	double seconds;
+} BatchScript;
+
+typedef struct Batch {
+	BatchScript* scripts;
+	int capacity;
+	int count;
+	int next; //the next script a worker should take
+	int optimize; //passed on to each parser, defaults to 1
+	InterpreterLimits limits; //for each script, none by default
+
+	pthread_mutex_t lock;
+	pthread_cond_t finished; //signalled whenever a script is done
+} Batch;
+
+void initBatch(Batch* batch);
+void freeBatch(Batch* batch);
+
+//"@filename" adds every non-empty line of that file instead, returns false if it can't be read
+bool pushBatch(Batch* batch, char* path);
+
+//run everything with this many workers, writing to stdout and stderr, then return the number of scripts that failed
+int runBatch(Batch* batch, int jobs);
@@ -15,6 +15,26 @@ void initCommand(int argc, const char* argv[]) {
 	command.source = NULL;
 	command.verbose = false;
 	command.optimize = 1;
+	command.profile = false;
+	command.profileJson = NULL;
+	command.stats = false;
+	command.statsJson = NULL;
+	command.sample = false;
+	command.sampleFolded = NULL;
+	command.trace = NULL;
+	command.batch = false;
+	command.scripts = NULL;
+	command.scriptCount = 0;
+	command.jobs = 0;
+	command.parallel = false;
+	command.stream = false;
+	command.tokens = false;
+	command.serve = NULL;
+	command.cacheSize = 256;
+	command.maxInstructions = 0;
+	command.maxSeconds = 0;
+	command.maxStack = 0;
+	command.maxBytes = 0;
 
 	for (int i = 1; i < argc; i++) { //start at 1 to skip the program name
 		if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
@@ -44,6 +64,113 @@ void initCommand(int argc, const char* argv[]) {
 			continue;
 		}
 
+		if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--profile")) {
+			command.profile = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--profile-json") && i + 1 < argc) {
+			command.profile = true;
+			command.profileJson = (char*)argv[i + 1];
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--stats")) {
+			command.stats = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--stats-json") && i + 1 < argc) {
+			command.stats = true;
+			command.statsJson = (char*)argv[i + 1];
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--sample")) {
+			command.sample = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--sample-folded") && i + 1 < argc) {
+			command.sample = true;
+			command.sampleFolded = (char*)argv[i + 1];
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+			command.trace = (char*)argv[i + 1];
+			i++;
+			continue;
+		}
+
+		if ((!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) && i + 1 < argc) {
+			sscanf(argv[i + 1], "%d", &command.jobs);
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--parallel")) {
+			command.parallel = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--stream")) {
+			command.stream = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--tokens")) {
+			command.tokens = true;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+			command.serve = (char*)argv[i + 1];
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+			sscanf(argv[i + 1], "%d", &command.cacheSize);
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--max-instructions") && i + 1 < argc) {
+			sscanf(argv[i + 1], "%llu", &command.maxInstructions);
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--max-time") && i + 1 < argc) {
+			sscanf(argv[i + 1], "%lf", &command.maxSeconds);
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--max-stack") && i + 1 < argc) {
+			sscanf(argv[i + 1], "%d", &command.maxStack);
+			i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "--max-memory") && i + 1 < argc) {
+			sscanf(argv[i + 1], "%lld", &command.maxBytes);
+			i++;
+			continue;
+		}
+
+		//everything after this is a script to run
+		if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--batch")) {
+			command.batch = true;
+			command.scripts = (char**)&argv[i + 1];
+			command.scriptCount = argc - i - 1;
+			break;
+		}
+
 		if (!strncmp(argv[i], "-O", 2)) {
 			sscanf(argv[i], "-O%d", &command.optimize);
 			continue;
@@ -54,7 +181,7 @@ void initCommand(int argc, const char* argv[]) {
 }
 
 void usageCommand(int argc, const char* argv[]) {
-	printf("Usage: %s [-h | -v | [-OX][-d][-f filename | -i source]]\n\n", argv[0]);
+	printf("Usage: %s [-h | -v | [-OX][-d][-p][--stats][[-j N] --parallel | --stream | --tokens][--sample][--trace filename][--max-* N][-f filename | -i source | [-j N] -b file... | [-j N][--cache N] --serve socket]]\n\n", argv[0]);
 }
 
 void helpCommand(int argc, const char* argv[]) {
@@ -62,9 +189,27 @@ void helpCommand(int argc, const char* argv[]) {
 
 	printf("-h | --help\t\tShow this help then exit.\n");
 	printf("-v | --version\t\tShow version and copyright information then exit.\n");
-	printf("-f | --file filename\tParse and execute the source file.\n");
+	printf("-f | --file filename\tParse and execute the source file, or each statement from stdin as it arrives with -.\n");
 	printf("-i | --input source\tParse and execute this given string of source code.\n");
+	printf("-b | --batch file...\tExecute every remaining file across worker threads, @filename lists one file per line.\n");
+	printf("-j | --jobs N\t\tUse N worker threads in batch, server and parallel mode (default one per processor).\n");
+	printf("--parallel\t\tCompile the file or source across the worker threads, producing the same bytecode.\n");
+	printf("--stream\t\tExecute each statement of the file or source as soon as it's compiled, in flat memory.\n");
+	printf("--tokens\t\tLex the whole file or source before parsing it, timed apart with --stats.\n");
+	printf("--serve socket\t\tCompile and execute scripts sent over this unix socket, until killed.\n");
+	printf("--cache N\t\tKeep up to N compiled programs in server mode (default 256).\n");
+	printf("--max-instructions N\tStop each run after N instructions.\n");
+	printf("--max-time seconds\tStop each run after this much time executing.\n");
+	printf("--max-stack N\t\tStop each run that holds more than N values at once.\n");
+	printf("--max-memory bytes\tStop each run that allocates more than this while executing.\n");
 	printf("-d | --debug\t\tBe verbose when operating.\n");
+	printf("-p | --profile\t\tCount and time each opcode executed, then report on exit.\n");
+	printf("--profile-json filename\tWrite the profile report as JSON instead.\n");
+	printf("--stats\t\t\tReport time and allocations for each phase of the run on exit.\n");
+	printf("--stats-json filename\tWrite the stats report as JSON instead.\n");
+	printf("--sample\t\tSample the running line with SIGPROF, then report hits per line on exit.\n");
+	printf("--sample-folded filename\tWrite the samples as folded stacks instead.\n");
+	printf("--trace filename\tWrite Chrome trace events for each phase of the run.\n");
 	printf("-OX\t\t\tUse level X optimization (default 1)\n");
 }
 
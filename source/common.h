@@ -9,6 +9,18 @@
 #define TOY_VERSION_PATCH 0
 #define TOY_VERSION_BUILD __DATE__ " " __TIME__
 
+//bumped whenever the collated bytecode layout changes
+#define TOY_BYTECODE_FORMAT 3
+
+//header flags, marking optional sections
+#define TOY_BYTECODE_FLAG_LINES 0x01
+
+//LEB128 varints hold at most 32 bits, so a longer run of continuation bytes is malformed
+#define TOY_VARINT_MAX_BYTES 5
+
+//receives output that would otherwise go to stdout or stderr
+typedef void (*PrintFn)(const char*);
+
 //for processing the command line arguments
 typedef struct {
 	bool error;
@@ -18,6 +30,26 @@ typedef struct {
 	char* source;
 	bool verbose;
 	int optimize;
+	bool profile;
+	char* profileJson;
+	bool stats;
+	char* statsJson;
+	bool sample;
+	char* sampleFolded;
+	char* trace;
+	bool batch;
+	char** scripts; //the remaining arguments, for batch mode
+	int scriptCount;
+	int jobs; //worker threads for batch, server and parallel mode, 0 to match the processors
+	bool parallel; //compile a single source across the worker threads
+	bool stream; //execute each statement of a single source as soon as it's compiled
+	bool tokens; //lex a single source into a token buffer before parsing it
+	char* serve; //socket path for server mode
+	int cacheSize; //compiled programs kept by the server
+	unsigned long long maxInstructions; //limits on each run, 0 for none
+	double maxSeconds;
+	int maxStack;
+	long long maxBytes;
 } Command;
 
 extern Command command;
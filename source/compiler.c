@@ -1,24 +1,18 @@
 #include "compiler.h"
 
 #include "memory.h"
+#include "trace.h"
 
 void initCompiler(Compiler* compiler) {
 	initLiteralArray(&compiler->literalCache);
+	initLiteralIndex(&compiler->literalIndex);
 	compiler->bytecode = NULL;
 	compiler->capacity = 0;
 	compiler->count = 0;
-
-	//default atomic literals
-	Literal n = TO_NULL_LITERAL;
-	Literal t = TO_BOOLEAN_LITERAL(true);
-	Literal f = TO_BOOLEAN_LITERAL(false);
-
-	pushLiteralArray(&compiler->literalCache, n);
-	pushLiteralArray(&compiler->literalCache, t);
-	pushLiteralArray(&compiler->literalCache, f);
+	initLineTable(&compiler->lines);
 }
 
-void writeCompiler(Compiler* compiler, Node* node) {
+static void emitCompilerByte(Compiler* compiler, unsigned char byte) {
 	//grow if the bytecode space is too small
 	if (compiler->capacity < compiler->count + 1) {
 		int oldCapacity = compiler->capacity;
@@ -27,60 +21,233 @@ void writeCompiler(Compiler* compiler, Node* node) {
 		compiler->bytecode = GROW_ARRAY(unsigned char, compiler->bytecode, oldCapacity, compiler->capacity);
 	}
 
-	//determine node type
-	switch(node->type) {
-		//TODO: more types, like variables, etc.
+	compiler->bytecode[compiler->count++] = byte;
+}
 
-		case NODE_LITERAL: {
-			//ensure the literal is in the cache
-			int index = findLiteralIndex(&compiler->literalCache, node->atomic.literal);
-			if (index < 0) {
-				index = pushLiteralArray(&compiler->literalCache, node->atomic.literal);
-			}
+//the code and the collation both use these, returns the number of bytes written
+static int encodeVarint(unsigned char* buffer, unsigned int value) {
+	//LEB128: 7 bits per byte, high bit set while more bytes follow
+	int count = 0;
 
-			//push the node opcode to the bytecode
-			if (index >= 256) {
-				//push a "long" index
-				compiler->bytecode[compiler->count++] = OP_LITERAL_LONG; //1 byte
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)index; //2 bytes
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
 
-				compiler->count += sizeof(unsigned short);
-			}
-			else {
-				//push the index
-				compiler->bytecode[compiler->count++] = OP_LITERAL; //1 byte
-				compiler->bytecode[compiler->count++] = (unsigned char)index; //1 byte
-			}
+		if (value != 0) {
+			byte |= 0x80;
+		}
+
+		buffer[count++] = byte;
+	} while (value != 0);
+
+	return count;
+}
+
+static int encodeSignedVarint(unsigned char* buffer, int value) {
+	//signed LEB128: stop once the remaining bits are all copies of the sign bit
+	int count = 0;
+	bool more = true;
+
+	while (more) {
+		unsigned char byte = value & 0x7F;
+		value >>= 7; //arithmetic shift keeps the sign
+
+		if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+			more = false;
+		}
+		else {
+			byte |= 0x80;
 		}
-		break;
 
-		case NODE_UNARY:
-			//pass to the child node, then embed the unary command (print, negate, etc.)
-			writeCompiler(compiler, node->unary.child);
-			compiler->bytecode[compiler->count++] = (unsigned char)node->unary.opcode; //1 byte
-		break;
+		buffer[count++] = byte;
+	}
 
-		case NODE_BINARY:
-			//pass to the child nodes, then embed the binary command (math, etc.)
-			writeCompiler(compiler, node->binary.left);
-			writeCompiler(compiler, node->binary.right);
-			compiler->bytecode[compiler->count++] = (unsigned char)node->binary.opcode; //1 byte
-		break;
+	return count;
+}
+
+static void emitCompilerVarint(Compiler* compiler, unsigned int value) {
+	unsigned char buffer[TOY_VARINT_MAX_BYTES];
+	int count = encodeVarint(buffer, value);
+
+	for (int i = 0; i < count; i++) {
+		emitCompilerByte(compiler, buffer[i]);
+	}
+}
 
-		case NODE_GROUPING:
-			compiler->bytecode[compiler->count++] = (unsigned char)OP_GROUPING_BEGIN; //1 byte
-			writeCompiler(compiler, node->grouping.child);
-			compiler->bytecode[compiler->count++] = (unsigned char)OP_GROUPING_END; //1 byte
-		break;
+static void emitCompilerIndex(Compiler* compiler, int index) {
+	//push the node opcode to the bytecode
+	if (index >= 256) {
+		//push a "long" index
+		emitCompilerByte(compiler, OP_LITERAL_LONG); //1 byte
+		emitCompilerVarint(compiler, (unsigned int)index); //2-5 bytes
+	}
+	else {
+		//push the index
+		emitCompilerByte(compiler, OP_LITERAL); //1 byte
+		emitCompilerByte(compiler, (unsigned char)index); //1 byte
 	}
 }
 
+void writeCompilerLiteral(Compiler* compiler, Literal literal) {
+	//common values are embedded directly in the instruction
+	if (IS_NULL(literal)) {
+		emitCompilerByte(compiler, OP_LITERAL_NULL); //1 byte
+		return;
+	}
+
+	if (IS_BOOLEAN(literal)) {
+		emitCompilerByte(compiler, AS_BOOLEAN(literal) ? OP_LITERAL_TRUE : OP_LITERAL_FALSE); //1 byte
+		return;
+	}
+
+	if (IS_INTEGER(literal) && AS_INTEGER(literal) >= -128 && AS_INTEGER(literal) <= 127) {
+		emitCompilerByte(compiler, OP_LITERAL_INTEGER); //1 byte
+		emitCompilerByte(compiler, (unsigned char)(signed char)AS_INTEGER(literal)); //1 byte
+		return;
+	}
+
+	//ensure the literal is in the cache
+	emitCompilerIndex(compiler, internLiteralArray(&compiler->literalCache, &compiler->literalIndex, literal));
+}
+
+void writeCompilerOpcode(Compiler* compiler, Opcode opcode) {
+	emitCompilerByte(compiler, (unsigned char)opcode); //1 byte
+}
+
+void writeCompiler(Compiler* compiler, NodeArray* nodes) {
+	TRACE_BEGIN("compiler", "compile");
+
+	//the nodes are in post-order, so the children's code is always written before their parent's command
+	for (int i = 0; i < nodes->count; i++) {
+		Node* node = &nodes->nodes[i];
+
+		//determine node type
+		switch(node->type) {
+			//TODO: more types, like variables, etc.
+
+			case NODE_LITERAL:
+				writeCompilerLiteral(compiler, nodes->literals[node->operand]);
+			break;
+
+			case NODE_UNARY: //print, negate, etc.
+			case NODE_BINARY: //math, etc.
+				emitCompilerByte(compiler, node->opcode); //1 byte
+			break;
+
+			case NODE_GROUPING_BEGIN:
+				emitCompilerByte(compiler, (unsigned char)OP_GROUPING_BEGIN); //1 byte
+			break;
+
+			case NODE_GROUPING:
+				emitCompilerByte(compiler, (unsigned char)OP_GROUPING_END); //1 byte
+			break;
+		}
+	}
+
+	TRACE_END("compiler", "compile");
+}
+
+void appendCompiler(Compiler* compiler, Compiler* other) {
+	TRACE_BEGIN("compiler", "append");
+
+	//the other cache is in order of first use, so interning it in order gives the same indices as writing the code here
+	int* indices = ALLOCATE(int, other->literalCache.count);
+
+	for (int i = 0; i < other->literalCache.count; i++) {
+		indices[i] = internLiteralArray(&compiler->literalCache, &compiler->literalIndex, other->literalCache.literals[i]);
+	}
+
+	int line = 0; //the next entry in the other line table
+	int i = 0;
+
+	while (i < other->count) {
+		//the offsets shift as the indices change width
+		while (line < other->lines.count && other->lines.offsets[line] == i) {
+			markCompilerLine(compiler, other->lines.lines[line++]);
+		}
+
+		unsigned char opcode = other->bytecode[i++];
+
+		switch(opcode) {
+			case OP_LITERAL:
+				emitCompilerIndex(compiler, indices[other->bytecode[i++]]);
+			break;
+
+			case OP_LITERAL_LONG: {
+				unsigned int index = 0;
+				int shift = 0;
+				unsigned char byte;
+
+				do {
+					byte = other->bytecode[i++];
+					index |= (unsigned int)(byte & 0x7F) << shift;
+					shift += 7;
+				} while (byte & 0x80);
+
+				emitCompilerIndex(compiler, indices[index]);
+			}
+			break;
+
+			case OP_LITERAL_INTEGER:
+				emitCompilerByte(compiler, opcode);
+				emitCompilerByte(compiler, other->bytecode[i++]);
+			break;
+
+			default:
+				emitCompilerByte(compiler, opcode);
+		}
+	}
+
+	//lines marked after the last of the code
+	while (line < other->lines.count) {
+		markCompilerLine(compiler, other->lines.lines[line++]);
+	}
+
+	FREE_ARRAY(int, indices, other->literalCache.count);
+
+	TRACE_END("compiler", "append");
+}
+
+unsigned char* flushCompiler(Compiler* compiler, int* size) {
+	emitCompilerByte(compiler, OP_EOF);
+
+	*size = compiler->count;
+	compiler->count = 0;
+
+	return compiler->bytecode;
+}
+
+unsigned char* releaseCompiler(Compiler* compiler, int* size, LiteralArray* literals, LineTable* lines) {
+	TRACE_BEGIN("compiler", "release");
+	emitCompilerByte(compiler, OP_EOF);
+
+	//exactly the size of the code, which is what the interpreter frees it as
+	unsigned char* code = SHRINK_ARRAY(unsigned char, compiler->bytecode, compiler->capacity, compiler->count);
+
+	*size = compiler->count;
+	*literals = compiler->literalCache;
+	*lines = compiler->lines;
+
+	//the index is no use without the literals
+	freeLiteralIndex(&compiler->literalIndex);
+	initCompiler(compiler);
+
+	TRACE_END("compiler", "release");
+	return code;
+}
+
 void freeCompiler(Compiler* compiler) {
 	freeLiteralArray(&compiler->literalCache);
-	FREE(unsigned char, compiler->bytecode);
+	freeLiteralIndex(&compiler->literalIndex);
+	FREE_ARRAY(unsigned char, compiler->bytecode, compiler->capacity);
 	compiler->bytecode = NULL;
 	compiler->capacity = 0;
 	compiler->count = 0;
+	freeLineTable(&compiler->lines);
+}
+
+void markCompilerLine(Compiler* compiler, int line) {
+	pushLineTable(&compiler->lines, compiler->count, line);
 }
 
 static void emitByte(char** collationPtr, int* capacityPtr, int* countPtr, unsigned char byte) {
@@ -95,24 +262,22 @@ static void emitByte(char** collationPtr, int* capacityPtr, int* countPtr, unsig
 	(*collationPtr)[(*countPtr)++] = byte;
 }
 
-static void emitShort(char** collationPtr, int* capacityPtr, int* countPtr, unsigned short bytes) {
-	char* ptr = (char*)&bytes;
+static void emitVarint(char** collationPtr, int* capacityPtr, int* countPtr, unsigned int value) {
+	unsigned char buffer[TOY_VARINT_MAX_BYTES];
+	int count = encodeVarint(buffer, value);
 
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
-	ptr++;
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
+	for (int i = 0; i < count; i++) {
+		emitByte(collationPtr, capacityPtr, countPtr, buffer[i]);
+	}
 }
 
-static void emitInt(char** collationPtr, int* capacityPtr, int* countPtr, int bytes) {
-	char* ptr = (char*)&bytes;
+static void emitSignedVarint(char** collationPtr, int* capacityPtr, int* countPtr, int value) {
+	unsigned char buffer[TOY_VARINT_MAX_BYTES];
+	int count = encodeSignedVarint(buffer, value);
 
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
-	ptr++;
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
-	ptr++;
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
-	ptr++;
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
+	for (int i = 0; i < count; i++) {
+		emitByte(collationPtr, capacityPtr, countPtr, buffer[i]);
+	}
 }
 
 static void emitFloat(char** collationPtr, int* capacityPtr, int* countPtr, float bytes) {
@@ -129,6 +294,8 @@ static void emitFloat(char** collationPtr, int* capacityPtr, int* countPtr, floa
 
 //return the result
 char* collateCompiler(Compiler* compiler, int* size) {
+	TRACE_BEGIN("compiler", "collate");
+
 	int capacity = GROW_CAPACITY(0);
 	int count = 0;
 	char* collation = ALLOCATE(char, capacity);
@@ -137,6 +304,8 @@ char* collateCompiler(Compiler* compiler, int* size) {
 	emitByte(&collation, &capacity, &count, TOY_VERSION_MAJOR);
 	emitByte(&collation, &capacity, &count, TOY_VERSION_MINOR);
 	emitByte(&collation, &capacity, &count, TOY_VERSION_PATCH);
+	emitByte(&collation, &capacity, &count, TOY_BYTECODE_FORMAT);
+	emitByte(&collation, &capacity, &count, compiler->lines.count > 0 ? TOY_BYTECODE_FLAG_LINES : 0);
 
 	//embed the build info
 	if (strlen(TOY_VERSION_BUILD) + count + 1 > capacity) {
@@ -151,8 +320,8 @@ char* collateCompiler(Compiler* compiler, int* size) {
 
 	emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate header
 
-	//embed the data section (first short is the number of literals)
-	emitShort(&collation, &capacity, &count, compiler->literalCache.count);
+	//embed the data section (first varint is the number of literals)
+	emitVarint(&collation, &capacity, &count, compiler->literalCache.count);
 
 	//emit each literal by type
 	for (int i = 0; i < compiler->literalCache.count; i++) {
@@ -173,7 +342,7 @@ char* collateCompiler(Compiler* compiler, int* size) {
 
 			case LITERAL_INTEGER:
 				emitByte(&collation, &capacity, &count, LITERAL_INTEGER);
-				emitInt(&collation, &capacity, &count, AS_INTEGER(compiler->literalCache.literals[i]));
+				emitSignedVarint(&collation, &capacity, &count, AS_INTEGER(compiler->literalCache.literals[i]));
 			break;
 
 			case LITERAL_FLOAT:
@@ -198,6 +367,24 @@ char* collateCompiler(Compiler* compiler, int* size) {
 
 	emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate data
 
+	//optional debug section, as deltas from the previous entry
+	if (compiler->lines.count > 0) {
+		emitVarint(&collation, &capacity, &count, compiler->lines.count);
+
+		int offset = 0;
+		int line = 0;
+
+		for (int i = 0; i < compiler->lines.count; i++) {
+			emitVarint(&collation, &capacity, &count, compiler->lines.offsets[i] - offset);
+			emitSignedVarint(&collation, &capacity, &count, compiler->lines.lines[i] - line);
+
+			offset = compiler->lines.offsets[i];
+			line = compiler->lines.lines[i];
+		}
+
+		emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate lines
+	}
+
 	//code section
 	for (int i = 0; i < compiler->count; i++) {
 		emitByte(&collation, &capacity, &count, compiler->bytecode[i]);
@@ -208,9 +395,11 @@ char* collateCompiler(Compiler* compiler, int* size) {
 	emitByte(&collation, &capacity, &count, OP_EOF); //terminate bytecode
 
 	//finalize
-	SHRINK_ARRAY(char, collation, capacity, count);
+	collation = SHRINK_ARRAY(char, collation, capacity, count);
 
 	*size = count;
 
+	TRACE_END("compiler", "collate");
+
 	return collation;	
 }
\ No newline at end of file
@@ -4,18 +4,41 @@
 
 #include "node.h"
 #include "literal_array.h"
+#include "line_table.h"
 
 //the compiler takes the nodes, and turns them into sequential chunks of bytecode, saving literals to an external array
 typedef struct Compiler {
 	LiteralArray literalCache;
+	LiteralIndex literalIndex; //for finding literals in the cache
 	unsigned char* bytecode;
 	int capacity;
 	int count;
+	LineTable lines; //empty unless the host marks lines
 } Compiler;
 
 void initCompiler(Compiler* compiler);
-void writeCompiler(Compiler* compiler, Node* node);
+void writeCompiler(Compiler* compiler, NodeArray* nodes);
 void freeCompiler(Compiler* compiler);
 
+//the pieces writeCompiler() is built from, for front ends that skip the nodes, the literal is copied if it needs to be kept
+void writeCompilerLiteral(Compiler* compiler, Literal literal);
+void writeCompilerOpcode(Compiler* compiler, Opcode opcode);
+
+//append the code another compiler has written, as if it had been written here, the other compiler is left as is
+//its literals are moved into this cache, so the code is re-encoded with their new indices
+void appendCompiler(Compiler* compiler, Compiler* other);
+
+//code written after this belongs to the given source line, and is recorded in the debug section
+void markCompilerLine(Compiler* compiler, int line);
+
+//hand over the code written since the last flush, terminated with OP_EOF, without collating it
+//the buffer still belongs to the compiler and is overwritten by later writes, while the literals are kept for deduplication
+unsigned char* flushCompiler(Compiler* compiler, int* size);
+
+//hand the code, terminated with OP_EOF, and the literals and line table over to the caller, without collating them
+//for executing in the same process with initInterpreterCode(), the compiler is left empty
+unsigned char* releaseCompiler(Compiler* compiler, int* size, LiteralArray* literals, LineTable* lines);
+
 //embed the header with version information, data section, code section, etc.
+//only needed to keep the bytecode for later, such as on disk, since releaseCompiler() skips the round trip
 char* collateCompiler(Compiler* compiler, int* size);
@@ -15,18 +15,48 @@ static unsigned char printByte(const char* tb, int* count) {
 	return ret;
 }
 
-static unsigned short printShort(const char* tb, int* count) {
-	unsigned short ret = *(unsigned short*)(tb + *count);
-	printf("%d ", ret);
-	*count += 2;
-	return ret;
+//returns false if the varint runs past TOY_VARINT_MAX_BYTES, after saying so
+static bool printVarint(const char* tb, int* count, unsigned int* value) {
+	unsigned int ret = 0;
+
+	for (int shift = 0; shift < TOY_VARINT_MAX_BYTES * 7; shift += 7) {
+		unsigned char byte = *(unsigned char*)(tb + *count);
+		*count += 1;
+		ret |= (unsigned int)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			printf("%u ", ret);
+			*value = ret;
+			return true;
+		}
+	}
+
+	printf("\nMalformed varint, stopping\n");
+	return false;
 }
 
-static int printInt(const char* tb, int* count) {
-	int ret = *(int*)(tb + *count);
-	printf("%d ", ret);
-	*count += 4;
-	return ret;
+static bool printSignedVarint(const char* tb, int* count, int* value) {
+	unsigned int ret = 0;
+
+	for (int shift = 0; shift < TOY_VARINT_MAX_BYTES * 7; shift += 7) {
+		unsigned char byte = *(unsigned char*)(tb + *count);
+		*count += 1;
+		ret |= (unsigned int)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			//sign extend from the last byte read
+			if (shift + 7 < 32 && (byte & 0x40)) {
+				ret |= ~0u << (shift + 7);
+			}
+
+			printf("%d ", (int)ret);
+			*value = (int)ret;
+			return true;
+		}
+	}
+
+	printf("\nMalformed varint, stopping\n");
+	return false;
 }
 
 static float printFloat(const char* tb, int* count) {
@@ -49,13 +79,6 @@ static void consumeByte(unsigned char byte, const char* str, int* count) {
 	*count += 1;
 }
 
-static void consumeShort(unsigned short bytes, const char* str, int* count) {
-	if (bytes != *(unsigned short*)(str + *count)) {
-		printf("Failed to consume the correct bytes");
-	}
-	*count += 2;
-}
-
 void dissectBytecode(const char* tb, int size) {
 	int count = 0;
 
@@ -64,6 +87,8 @@ void dissectBytecode(const char* tb, int size) {
 	printByte(tb, &count);
 	printByte(tb, &count);
 	printByte(tb, &count);
+	printByte(tb, &count); //format revision
+	const unsigned char flags = printByte(tb, &count);
 	printString(tb, &count);
 	consumeByte(OP_SECTION_END, tb, &count);
 
@@ -71,9 +96,13 @@ void dissectBytecode(const char* tb, int size) {
 
 	//data
 	printf("--data--\n");
-	const short literalCount = printShort(tb, &count);
+	unsigned int literalCount = 0;
+
+	if (!printVarint(tb, &count, &literalCount)) {
+		return;
+	}
 
-	for (int i = 0; i < literalCount; i++) {
+	for (unsigned int i = 0; i < literalCount; i++) {
 		const unsigned char literalType = printByte(tb, &count);
 
 		switch(literalType) {
@@ -89,7 +118,12 @@ void dissectBytecode(const char* tb, int size) {
 			break;
 
 			case LITERAL_INTEGER: {
-				const int d = printInt(tb, &count);
+				int d = 0;
+
+				if (!printSignedVarint(tb, &count, &d)) {
+					return;
+				}
+
 				printf("(integer %d)", d);
 			}
 			break;
@@ -112,6 +146,36 @@ void dissectBytecode(const char* tb, int size) {
 
 	consumeByte(OP_SECTION_END, tb, &count);
 
+	//lines
+	if (flags & TOY_BYTECODE_FLAG_LINES) {
+		printf("--lines--\n");
+		unsigned int lineCount = 0;
+
+		if (!printVarint(tb, &count, &lineCount)) {
+			return;
+		}
+
+		printf("\n");
+
+		int offset = 0;
+		int line = 0;
+
+		for (unsigned int i = 0; i < lineCount; i++) {
+			unsigned int offsetDelta = 0;
+			int lineDelta = 0;
+
+			if (!printVarint(tb, &count, &offsetDelta) || !printSignedVarint(tb, &count, &lineDelta)) {
+				return;
+			}
+
+			offset += (int)offsetDelta;
+			line += lineDelta;
+			printf("(offset %d line %d)\n", offset, line);
+		}
+
+		consumeByte(OP_SECTION_END, tb, &count);
+	}
+
 	//code
 	printf("--bytecode--\n");
 	while(tb[count] != OP_EOF) {
@@ -130,12 +194,34 @@ void dissectBytecode(const char* tb, int size) {
 			break;
 
 			case OP_LITERAL_LONG: {
+				unsigned int index = 0;
 				printf("long literal ");
-				printShort(tb, &count);
+
+				if (!printVarint(tb, &count, &index)) {
+					return;
+				}
+
 				printf("\n");
 			}
 			break;
 
+			case OP_LITERAL_NULL:
+				printf("null\n");
+			break;
+
+			case OP_LITERAL_TRUE:
+				printf("true\n");
+			break;
+
+			case OP_LITERAL_FALSE:
+				printf("false\n");
+			break;
+
+			case OP_LITERAL_INTEGER: {
+				printf("integer %d\n", (signed char)printByte(tb, &count));
+			}
+			break;
+
 			case OP_NEGATE: {
 				printf("negate\n");
 			}
@@ -147,9 +233,39 @@ void dissectBytecode(const char* tb, int size) {
 			break;
 
 			default:
-				printf("Unknown opcode found\n");
+				if (findOpcodeName(opcode) != NULL) {
+					printf("%s\n", findOpcodeName(opcode));
+				}
+				else {
+					printf("Unknown opcode found\n");
+				}
 		}
 	}
 
 	consumeByte(OP_EOF, tb, &count);
+}
+
+char* findOpcodeName(Opcode opcode) {
+	switch(opcode) {
+		case OP_EOF: return "eof";
+		case OP_ASSERT: return "assert";
+		case OP_PRINT: return "print";
+		case OP_LITERAL: return "literal";
+		case OP_LITERAL_LONG: return "long literal";
+		case OP_LITERAL_NULL: return "null";
+		case OP_LITERAL_TRUE: return "true";
+		case OP_LITERAL_FALSE: return "false";
+		case OP_LITERAL_INTEGER: return "integer";
+		case OP_NEGATE: return "negate";
+		case OP_ADDITION: return "addition";
+		case OP_SUBTRACTION: return "subtraction";
+		case OP_MULTIPLICATION: return "multiplication";
+		case OP_DIVISION: return "division";
+		case OP_MODULO: return "modulo";
+		case OP_GROUPING_BEGIN: return "grouping begin";
+		case OP_GROUPING_END: return "grouping end";
+		case OP_SECTION_END: return "section end";
+	}
+
+	return NULL;
 }
\ No newline at end of file
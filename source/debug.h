@@ -1,5 +1,9 @@
 #pragma once
 
 #include "common.h"
+#include "opcodes.h"
 
-void dissectBytecode(const char* tb, int size);
\ No newline at end of file
+void dissectBytecode(const char* tb, int size);
+
+//for reports, returns NULL for unknown opcodes
+char* findOpcodeName(Opcode opcode);
\ No newline at end of file
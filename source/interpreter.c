@@ -2,19 +2,26 @@
 
 #include "common.h"
 #include "memory.h"
+#include "trace.h"
 
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#define INTERPRETER_CHECK_INTERVAL 1024 //instructions between checks of the clock, memory and preemption
 
 static void stdoutWrapper(const char* output) {
-	fprintf(stdout, output);
-	fprintf(stdout, "\n"); //default new line
+	fprintf(stdout, "%s\n", output); //default new line
 }
 
 static void stderrWrapper(const char* output) {
-	fprintf(stderr, "Assertion failure: ");
-	fprintf(stderr, output);
-	fprintf(stderr, "\n"); //default new line
+	fprintf(stderr, "Assertion failure: %s\n", output); //default new line
+}
+
+static void errorWrapper(const char* output) {
+	fprintf(stderr, "%s", output); //reports end in their own new line
 }
 
 void initInterpreter(Interpreter* interpreter, unsigned char* bytecode, int length) {
@@ -22,16 +29,57 @@ void initInterpreter(Interpreter* interpreter, unsigned char* bytecode, int leng
 	interpreter->bytecode = bytecode;
 	interpreter->length = length;
 	interpreter->count = 0;
+	interpreter->codeStart = 0;
+	interpreter->loaded = false;
+	interpreter->borrowed = false;
+	interpreter->instructions = 0;
+	interpreter->verbose = false;
+	interpreter->depth = 0;
+	interpreter->status = INTERPRETER_YIELDED; //nothing has run yet
+	interpreter->limits = (InterpreterLimits){ 0, 0, 0, 0 };
+	atomic_init(&interpreter->preempted, false);
+	interpreter->elapsed = 0;
+	interpreter->allocated = 0;
+	initLineTable(&interpreter->lines);
 
 	initLiteralArray(&interpreter->stack);
 
 	setInterpreterPrint(interpreter, stdoutWrapper);
 	setInterpreterAssert(interpreter, stderrWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+	setInterpreterProfiler(interpreter, NULL);
+}
+
+void initInterpreterShared(Interpreter* interpreter, LiteralArray* literalCache, LineTable* lines, unsigned char* bytecode, int length, int codeStart) {
+	initInterpreter(interpreter, bytecode, length);
+
+	//shallow copies, never freed here
+	interpreter->literalCache = *literalCache;
+	interpreter->lines = *lines;
+	interpreter->count = codeStart;
+	interpreter->codeStart = codeStart;
+	interpreter->loaded = true;
+	interpreter->borrowed = true;
+}
+
+void initInterpreterCode(Interpreter* interpreter, LiteralArray* literalCache, LineTable* lines, unsigned char* code, int length) {
+	TRACE_BEGIN("interpreter", "handoff");
+	initInterpreter(interpreter, code, length);
+
+	//moved rather than copied, and freed with the interpreter
+	interpreter->literalCache = *literalCache;
+	interpreter->lines = *lines;
+	interpreter->loaded = true;
+	TRACE_END("interpreter", "handoff");
 }
 
 void freeInterpreter(Interpreter* interpreter) {
-	freeLiteralArray(&interpreter->literalCache);
-	FREE_ARRAY(char, interpreter->bytecode, interpreter->length);
+	if (!interpreter->borrowed) {
+		freeLiteralArray(&interpreter->literalCache);
+		FREE_ARRAY(char, interpreter->bytecode, interpreter->length);
+		freeLineTable(&interpreter->lines);
+	}
+
 	freeLiteralArray(&interpreter->stack);
 }
 
@@ -44,23 +92,68 @@ void setInterpreterAssert(Interpreter* interpreter, PrintFn assertOutput) {
 	interpreter->assertOutput = assertOutput;
 }
 
+void setInterpreterError(Interpreter* interpreter, PrintFn errorOutput) {
+	interpreter->errorOutput = errorOutput;
+}
+
+void setInterpreterProfiler(Interpreter* interpreter, Profiler* profiler) {
+	interpreter->profiler = profiler;
+}
+
 //utils
+static void error(Interpreter* interpreter, const char* format, ...) {
+	char buffer[512];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	(*interpreter->errorOutput)(buffer);
+}
+
 static unsigned char readByte(unsigned char* tb, int* count) {
 	unsigned char ret = *(unsigned char*)(tb + *count);
 	*count += 1;
 	return ret;
 }
 
-static unsigned short readShort(unsigned char* tb, int* count) {
-	unsigned short ret = *(unsigned short*)(tb + *count);
-	*count += 2;
-	return ret;
+//returns false if the varint runs past TOY_VARINT_MAX_BYTES, which only malformed bytecode does
+static bool readVarint(unsigned char* tb, int* count, unsigned int* value) {
+	unsigned int ret = 0;
+
+	for (int shift = 0; shift < TOY_VARINT_MAX_BYTES * 7; shift += 7) {
+		unsigned char byte = readByte(tb, count);
+		ret |= (unsigned int)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			*value = ret;
+			return true;
+		}
+	}
+
+	return false;
 }
 
-static int readInt(unsigned char* tb, int* count) {
-	int ret = *(int*)(tb + *count);
-	*count += 4;
-	return ret;
+static bool readSignedVarint(unsigned char* tb, int* count, int* value) {
+	unsigned int ret = 0;
+
+	for (int shift = 0; shift < TOY_VARINT_MAX_BYTES * 7; shift += 7) {
+		unsigned char byte = readByte(tb, count);
+		ret |= (unsigned int)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			//sign extend from the last byte read
+			if (shift + 7 < 32 && (byte & 0x40)) {
+				ret |= ~0u << (shift + 7);
+			}
+
+			*value = (int)ret;
+			return true;
+		}
+	}
+
+	return false;
 }
 
 static float readFloat(unsigned char* tb, int* count) {
@@ -75,18 +168,11 @@ static char* readString(unsigned char* tb, int* count) {
 	return ret;
 }
 
-static void consumeByte(unsigned char byte, unsigned char* tb, int* count) {
-	if (byte != tb[*count]) {
-		printf("Failed to consume the correct byte\n");
-	}
-	*count += 1;
-}
-
-static void consumeShort(unsigned short bytes, unsigned char* tb, int* count) {
-	if (bytes != *(unsigned short*)(tb + *count)) {
-		printf("Failed to consume the correct bytes\n");
+static void consumeByte(Interpreter* interpreter, unsigned char byte) {
+	if (byte != interpreter->bytecode[interpreter->count]) {
+		error(interpreter, "Failed to consume the correct byte\n");
 	}
-	*count += 2;
+	interpreter->count += 1;
 }
 
 //each available statement
@@ -95,9 +181,9 @@ static bool execAssert(Interpreter* interpreter) {
 	Literal lhs = popLiteralArray(&interpreter->stack);
 
 	if (!IS_STRING(rhs)) {
-		printf("[internal] The interpreter's assert keyword needs a string as the second argument, received: ");
-		printLiteral(rhs);
-		printf("\n");
+		char buffer[256];
+		formatLiteral(rhs, buffer, sizeof(buffer));
+		error(interpreter, "[internal] The interpreter's assert keyword needs a string as the second argument, received: %s\n", buffer);
 		return false;
 	}
 
@@ -125,7 +211,14 @@ static bool execPushLiteral(Interpreter* interpreter, bool lng) {
 	int index = 0;
 
 	if (lng) {
-		index = (int)readShort(interpreter->bytecode, &interpreter->count);
+		unsigned int value = 0;
+
+		if (!readVarint(interpreter->bytecode, &interpreter->count, &value)) {
+			error(interpreter, "[internal] Malformed literal index found, terminating\n");
+			return false;
+		}
+
+		index = (int)value;
 	}
 	else {
 		index = (int)readByte(interpreter->bytecode, &interpreter->count);
@@ -137,6 +230,31 @@ static bool execPushLiteral(Interpreter* interpreter, bool lng) {
 	return true;
 }
 
+static bool execPushImmediate(Interpreter* interpreter, Opcode opcode) {
+	//the value is carried by the instruction itself
+	switch(opcode) {
+		case OP_LITERAL_NULL:
+			pushLiteralArray(&interpreter->stack, TO_NULL_LITERAL);
+			return true;
+
+		case OP_LITERAL_TRUE:
+			pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(true));
+			return true;
+
+		case OP_LITERAL_FALSE:
+			pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(false));
+			return true;
+
+		case OP_LITERAL_INTEGER: {
+			const signed char value = (signed char)readByte(interpreter->bytecode, &interpreter->count);
+			pushLiteralArray(&interpreter->stack, TO_INTEGER_LITERAL(value));
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static bool execNegate(Interpreter* interpreter) {
 	//negate the top literal on the stack
 	Literal lit = popLiteralArray(&interpreter->stack);
@@ -148,9 +266,9 @@ static bool execNegate(Interpreter* interpreter) {
 		lit = TO_FLOAT_LITERAL(-AS_FLOAT(lit));
 	}
 	else {
-		printf("[internal] The interpreter can't negate that literal: ");
-		printLiteral(lit);
-		printf("\n");
+		char buffer[256];
+		formatLiteral(lit, buffer, sizeof(buffer));
+		error(interpreter, "[internal] The interpreter can't negate that literal: %s\n", buffer);
 		return false;
 	}
 
@@ -199,7 +317,7 @@ static bool execArithmetic(Interpreter* interpreter, Opcode opcode) {
 
 	//catch bad modulo
 	if (opcode == OP_MODULO) {
-		printf("Bad arithmetic argument (modulo on floats not allowed)\n");
+		error(interpreter, "Bad arithmetic argument (modulo on floats not allowed)\n");
 		return false;
 	}
 
@@ -224,38 +342,152 @@ static bool execArithmetic(Interpreter* interpreter, Opcode opcode) {
 	}
 
 	//wrong types
-	printf("Bad arithmetic argument\n");
+	error(interpreter, "Bad arithmetic argument\n");
 	return false;
 }
 
-//the heart of toy
-static void execInterpreter(Interpreter* interpreter) {
-	unsigned char opcode = readByte(interpreter->bytecode, &interpreter->count);
+static double readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//where a single call to execInterpreter() has to stop, either to yield the step or because a limit is reached
+typedef struct Budget {
+	unsigned long long yieldAt; //instruction counts
+	unsigned long long stopAt;
+	double yieldBy; //clock times, 0 for none
+	double stopBy;
+	long long memoryStop; //live bytes on this thread, 0 for none
+	int stackStop;
+} Budget;
+
+static unsigned long long nextCheckpoint(unsigned long long instructions, Budget* budget) {
+	unsigned long long checkpoint = instructions + INTERPRETER_CHECK_INTERVAL;
+
+	if (budget->yieldAt < checkpoint) {
+		checkpoint = budget->yieldAt;
+	}
+
+	if (budget->stopAt < checkpoint) {
+		checkpoint = budget->stopAt;
+	}
+
+	return checkpoint;
+}
+
+//returns false if execution must stop here, with the reason in status
+static bool checkBudget(Interpreter* interpreter, Budget* budget, InterpreterStatus* status) {
+	if (atomic_load_explicit(&interpreter->preempted, memory_order_relaxed)) {
+		*status = INTERPRETER_PREEMPTED;
+		return false;
+	}
+
+	if (interpreter->instructions >= budget->stopAt) {
+		*status = INTERPRETER_LIMIT_INSTRUCTIONS;
+		return false;
+	}
+
+	if (interpreter->instructions >= budget->yieldAt) {
+		*status = INTERPRETER_YIELDED;
+		return false;
+	}
+
+	if (budget->stopBy > 0 || budget->yieldBy > 0) {
+		const double now = readClock();
+
+		if (budget->stopBy > 0 && now >= budget->stopBy) {
+			*status = INTERPRETER_LIMIT_TIME;
+			return false;
+		}
+
+		if (budget->yieldBy > 0 && now >= budget->yieldBy) {
+			*status = INTERPRETER_YIELDED;
+			return false;
+		}
+	}
+
+	if (budget->memoryStop > 0 && getMemoryStats().current >= budget->memoryStop) {
+		*status = INTERPRETER_LIMIT_MEMORY;
+		return false;
+	}
+
+	return true;
+}
+
+//the heart of toy, runs until the end of the code, an error, or the budget is spent
+static InterpreterStatus execInterpreter(Interpreter* interpreter, Budget* budget) {
+	//the limits are only checked at checkpoints, which are never more than the interval apart
+	unsigned long long checkpoint = nextCheckpoint(interpreter->instructions, budget);
+
+	for (;;) {
+		if (interpreter->instructions == checkpoint) {
+			InterpreterStatus status;
+
+			if (!checkBudget(interpreter, budget, &status)) {
+				return status;
+			}
+
+			checkpoint = nextCheckpoint(interpreter->instructions, budget);
+		}
+
+		unsigned char opcode = readByte(interpreter->bytecode, &interpreter->count);
+
+		if (opcode == OP_EOF || opcode == OP_SECTION_END) {
+			return INTERPRETER_DONE;
+		}
+
+		interpreter->instructions++;
+
+#ifndef TOY_NO_PROFILER //define this to strip the check from the dispatch loop entirely
+		if (interpreter->profiler) {
+			recordProfiler(interpreter->profiler, opcode);
+		}
+#endif
 
-	while(opcode != OP_EOF && opcode != OP_SECTION_END) {
 		switch(opcode) {
 			case OP_ASSERT:
+				TRACE_COUNTER("stack", interpreter->stack.count);
 				if (!execAssert(interpreter)) {
-					return;
+					return INTERPRETER_ERROR;
 				}
 			break;
 
 			case OP_PRINT:
+				TRACE_COUNTER("stack", interpreter->stack.count);
 				if (!execPrint(interpreter)) {
-					return;
+					return INTERPRETER_ERROR;
 				}
 			break;
 
+			//only these grow the stack
 			case OP_LITERAL:
 			case OP_LITERAL_LONG:
 				if (!execPushLiteral(interpreter, opcode == OP_LITERAL_LONG)) {
-					return;
+					return INTERPRETER_ERROR;
+				}
+
+				if (interpreter->stack.count > budget->stackStop) {
+					return INTERPRETER_LIMIT_STACK;
+				}
+			break;
+
+			case OP_LITERAL_NULL:
+			case OP_LITERAL_TRUE:
+			case OP_LITERAL_FALSE:
+			case OP_LITERAL_INTEGER:
+				if (!execPushImmediate(interpreter, opcode)) {
+					return INTERPRETER_ERROR;
+				}
+
+				if (interpreter->stack.count > budget->stackStop) {
+					return INTERPRETER_LIMIT_STACK;
 				}
 			break;
 
 			case OP_NEGATE:
 				if (!execNegate(interpreter)) {
-					return;
+					return INTERPRETER_ERROR;
 				}
 			break;
 
@@ -265,54 +497,75 @@ static void execInterpreter(Interpreter* interpreter) {
 			case OP_DIVISION:
 			case OP_MODULO:
 				if (!execArithmetic(interpreter, opcode)) {
-					return;
+					return INTERPRETER_ERROR;
 				}
 			break;
 
 			case OP_GROUPING_BEGIN:
-				execInterpreter(interpreter);
+				TRACE_COUNTER("stack", interpreter->stack.count);
+				interpreter->depth++;
 			break;
 
 			case OP_GROUPING_END:
-				return;
+				//an unmatched end finishes the code, as it always has
+				if (interpreter->depth == 0) {
+					return INTERPRETER_DONE;
+				}
+
+				interpreter->depth--;
+			break;
 
 			default:
-				printf("Unknown opcode found %d, terminating\n", opcode);
-				printLiteralArray(&interpreter->stack, "\n");
-				return;
-		}
+				error(interpreter, "Unknown opcode found %d, terminating\n", opcode);
 
-		opcode = readByte(interpreter->bytecode, &interpreter->count);
+				if (interpreter->verbose) {
+					printLiteralArray(&interpreter->stack, "\n");
+				}
+				return INTERPRETER_ERROR;
+		}
 	}
 }
 
-void runInterpreter(Interpreter* interpreter) {
+static bool loadSections(Interpreter* interpreter) {
 	//header section
 	const unsigned char major = readByte(interpreter->bytecode, &interpreter->count);
 	const unsigned char minor = readByte(interpreter->bytecode, &interpreter->count);
 	const unsigned char patch = readByte(interpreter->bytecode, &interpreter->count);
+	const unsigned char format = readByte(interpreter->bytecode, &interpreter->count);
+	const unsigned char flags = readByte(interpreter->bytecode, &interpreter->count);
 	const char* build = readString(interpreter->bytecode, &interpreter->count);
 
-	if (command.verbose) {
+	//the layout can't be read at all if the format revision differs
+	if (format != TOY_BYTECODE_FORMAT) {
+		error(interpreter, "Error: bytecode format revision %d is not supported (expected %d)\n", format, TOY_BYTECODE_FORMAT);
+		return false;
+	}
+
+	if (interpreter->verbose) {
 		if (major != TOY_VERSION_MAJOR || minor != TOY_VERSION_MINOR || patch != TOY_VERSION_PATCH) {
 			printf("Warning: interpreter/bytecode version mismatch\n");
 		}
 
-		if (!strncmp(build, TOY_VERSION_BUILD, strlen(TOY_VERSION_BUILD))) {
+		if (strncmp(build, TOY_VERSION_BUILD, strlen(TOY_VERSION_BUILD))) {
 			printf("Warning: interpreter/bytecode build mismatch\n");
 		}
 	}
 
-	consumeByte(OP_SECTION_END, interpreter->bytecode, &interpreter->count);
+	consumeByte(interpreter, OP_SECTION_END);
 
 	//data section
-	const short literalCount = readShort(interpreter->bytecode, &interpreter->count);
+	unsigned int literalCount = 0;
 
-	if (command.verbose) {
-		printf("Reading %d literals\n", literalCount);
+	if (!readVarint(interpreter->bytecode, &interpreter->count, &literalCount)) {
+		error(interpreter, "Error: malformed literal count in the bytecode\n");
+		return false;
 	}
 
-	for (int i = 0; i < literalCount; i++) {
+	if (interpreter->verbose) {
+		printf("Reading %u literals\n", literalCount);
+	}
+
+	for (unsigned int i = 0; i < literalCount; i++) {
 		const unsigned char literalType = readByte(interpreter->bytecode, &interpreter->count);
 
 		switch(literalType) {
@@ -320,7 +573,7 @@ void runInterpreter(Interpreter* interpreter) {
 				//read the null
 				pushLiteralArray(&interpreter->literalCache, TO_NULL_LITERAL);
 
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(null)\n");
 				}
 			break;
@@ -330,17 +583,23 @@ void runInterpreter(Interpreter* interpreter) {
 				const bool b = readByte(interpreter->bytecode, &interpreter->count);
 				pushLiteralArray(&interpreter->literalCache, TO_BOOLEAN_LITERAL(b));
 
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(boolean %s)\n", b ? "true" : "false");
 				}
 			}
 			break;
 
 			case LITERAL_INTEGER: {
-				const int d = readInt(interpreter->bytecode, &interpreter->count);
+				int d = 0;
+
+				if (!readSignedVarint(interpreter->bytecode, &interpreter->count, &d)) {
+					error(interpreter, "Error: malformed integer literal in the bytecode\n");
+					return false;
+				}
+
 				pushLiteralArray(&interpreter->literalCache, TO_INTEGER_LITERAL(d));
 
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(integer %d)\n", d);
 				}
 			}
@@ -350,7 +609,7 @@ void runInterpreter(Interpreter* interpreter) {
 				const float f = readFloat(interpreter->bytecode, &interpreter->count);
 				pushLiteralArray(&interpreter->literalCache, TO_FLOAT_LITERAL(f));
 
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(float %f)\n", f);
 				}
 			}
@@ -360,7 +619,7 @@ void runInterpreter(Interpreter* interpreter) {
 				char* s = readString(interpreter->bytecode, &interpreter->count);
 				pushLiteralArray(&interpreter->literalCache, TO_STRING_LITERAL(s));
 
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(string \"%s\")\n", s);
 				}
 			}
@@ -368,12 +627,161 @@ void runInterpreter(Interpreter* interpreter) {
 		}
 	}
 
-	consumeByte(OP_SECTION_END, interpreter->bytecode, &interpreter->count);
+	consumeByte(interpreter, OP_SECTION_END);
+
+	//debug section
+	if (flags & TOY_BYTECODE_FLAG_LINES) {
+		unsigned int lineCount = 0;
+		int offset = 0;
+		int line = 0;
+
+		if (!readVarint(interpreter->bytecode, &interpreter->count, &lineCount)) {
+			error(interpreter, "Error: malformed line table in the bytecode\n");
+			return false;
+		}
+
+		for (unsigned int i = 0; i < lineCount; i++) {
+			unsigned int offsetDelta = 0;
+			int lineDelta = 0;
+
+			if (!readVarint(interpreter->bytecode, &interpreter->count, &offsetDelta) || !readSignedVarint(interpreter->bytecode, &interpreter->count, &lineDelta)) {
+				error(interpreter, "Error: malformed line table in the bytecode\n");
+				return false;
+			}
+
+			offset += (int)offsetDelta;
+			line += lineDelta;
+			pushLineTable(&interpreter->lines, offset, line);
+		}
+
+		if (interpreter->verbose) {
+			printf("Read %u line table entries\n", lineCount);
+		}
+
+		consumeByte(interpreter, OP_SECTION_END);
+	}
+
+	interpreter->codeStart = interpreter->count;
+	interpreter->loaded = true;
+
+	return true;
+}
+
+bool loadInterpreter(Interpreter* interpreter) {
+	TRACE_BEGIN("interpreter", "load");
+	bool result = loadSections(interpreter);
+	TRACE_END("interpreter", "load");
+	return result;
+}
+
+void runInterpreter(Interpreter* interpreter) {
+	if (!interpreter->loaded && !loadInterpreter(interpreter)) {
+		interpreter->status = INTERPRETER_ERROR;
+		return;
+	}
 
 	//code section
-	if (command.verbose) {
+	if (interpreter->verbose) {
 		printf("executing bytecode\n");
 	}
 
-	execInterpreter(interpreter);
+	stepInterpreter(interpreter, 0, 0);
+}
+
+//combine this step's budget with what's left of the interpreter's limits, then execute and account for it
+static InterpreterStatus execBudget(Interpreter* interpreter, unsigned long long instructions, double seconds) {
+	InterpreterLimits* limits = &interpreter->limits;
+	Budget budget;
+
+	const bool timed = seconds > 0 || limits->seconds > 0;
+	const double start = timed ? readClock() : 0;
+	const long long memoryStart = limits->bytes > 0 ? getMemoryStats().current : 0;
+
+	budget.yieldAt = instructions > 0 ? interpreter->instructions + instructions : ULLONG_MAX;
+	budget.stopAt = limits->instructions > 0 ? limits->instructions : ULLONG_MAX;
+	budget.yieldBy = seconds > 0 ? start + seconds : 0;
+	budget.stopBy = limits->seconds > 0 ? start + limits->seconds - interpreter->elapsed : 0;
+	budget.memoryStop = limits->bytes > 0 ? memoryStart + limits->bytes - interpreter->allocated : 0;
+	budget.stackStop = limits->stack > 0 ? limits->stack : INT_MAX;
+
+	TRACE_BEGIN("interpreter", "execute");
+	InterpreterStatus status = execInterpreter(interpreter, &budget);
+	TRACE_END("interpreter", "execute");
+
+	if (timed) {
+		interpreter->elapsed += readClock() - start;
+	}
+
+	if (limits->bytes > 0) {
+		interpreter->allocated += getMemoryStats().current - memoryStart;
+	}
+
+	//a run that won't resume has no use for its stack
+	if (status != INTERPRETER_YIELDED) {
+		freeLiteralArray(&interpreter->stack);
+	}
+
+	return status;
+}
+
+InterpreterStatus stepInterpreter(Interpreter* interpreter, unsigned long long budget, double seconds) {
+	//finished runs stay finished
+	if (interpreter->status != INTERPRETER_YIELDED) {
+		return interpreter->status;
+	}
+
+	if (!interpreter->loaded && !loadInterpreter(interpreter)) {
+		return interpreter->status = INTERPRETER_ERROR;
+	}
+
+	return interpreter->status = execBudget(interpreter, budget, seconds);
+}
+
+const char* describeInterpreterStatus(InterpreterStatus status) {
+	switch(status) {
+		case INTERPRETER_PREEMPTED:
+			return "Execution was preempted";
+
+		case INTERPRETER_LIMIT_INSTRUCTIONS:
+			return "Instruction limit exceeded";
+
+		case INTERPRETER_LIMIT_TIME:
+			return "Time limit exceeded";
+
+		case INTERPRETER_LIMIT_STACK:
+			return "Stack limit exceeded";
+
+		case INTERPRETER_LIMIT_MEMORY:
+			return "Memory limit exceeded";
+
+		default:
+			return NULL;
+	}
+}
+
+void preemptInterpreter(Interpreter* interpreter) {
+	atomic_store_explicit(&interpreter->preempted, true, memory_order_relaxed);
+}
+
+void runInterpreterCode(Interpreter* interpreter, LiteralArray* literals, unsigned char* code, int length) {
+	//catch up with the literal cache
+	for (int i = interpreter->literalCache.count; i < literals->count; i++) {
+		pushLiteralArray(&interpreter->literalCache, literals->literals[i]);
+	}
+
+	//borrow the code for the duration of this call
+	unsigned char* bytecode = interpreter->bytecode;
+	int bytecodeLength = interpreter->length;
+	int count = interpreter->count;
+
+	interpreter->bytecode = code;
+	interpreter->length = length;
+	interpreter->count = 0;
+	interpreter->depth = 0;
+
+	interpreter->status = execBudget(interpreter, 0, 0);
+
+	interpreter->bytecode = bytecode;
+	interpreter->length = bytecodeLength;
+	interpreter->count = count;
 }
@@ -3,8 +3,30 @@
 #include "opcodes.h"
 
 #include "literal_array.h"
+#include "profiler.h"
+#include "line_table.h"
 
-typedef void (*PrintFn)(const char*);
+#include <stdatomic.h>
+
+typedef enum InterpreterStatus {
+	INTERPRETER_DONE, //reached the end of the code
+	INTERPRETER_YIELDED, //the budget ran out, or nothing has run yet
+	INTERPRETER_ERROR, //stopped by an error or a failed assertion
+	INTERPRETER_PREEMPTED, //stopped by preemptInterpreter()
+	INTERPRETER_LIMIT_INSTRUCTIONS,
+	INTERPRETER_LIMIT_TIME,
+	INTERPRETER_LIMIT_STACK,
+	INTERPRETER_LIMIT_MEMORY,
+} InterpreterStatus;
+
+//a run that exceeds any of these is stopped for good, 0 for no limit
+//time and memory are checked every so many instructions, so a run can overshoot them slightly
+typedef struct InterpreterLimits {
+	unsigned long long instructions;
+	double seconds; //spent executing, across every step
+	int stack; //operand stack entries
+	long long bytes; //live bytes allocated through reallocate() while executing, across every step
+} InterpreterLimits;
 
 //the interpreter acts depending on the bytecode instructions
 typedef struct Interpreter {
@@ -12,16 +34,56 @@ typedef struct Interpreter {
 	unsigned char* bytecode;
 	int length;
 	int count;
+	int codeStart; //offset of the code section
+	bool loaded; //the header and data section have been read
+	bool borrowed; //the literals, lines and bytecode belong to someone else, such as a Program
+	LineTable lines; //empty unless the bytecode has a debug section
 	LiteralArray stack;
 	PrintFn printOutput;
 	PrintFn assertOutput;
+	PrintFn errorOutput; //runtime and load errors, each report ends in a new line
+	Profiler* profiler; //NULL unless profiling
+	unsigned long long instructions; //dispatched so far
+	bool verbose; //report on loading and execution
+	int depth; //of the groupings currently open
+	InterpreterStatus status; //of the last step
+	InterpreterLimits limits;
+	atomic_bool preempted;
+	double elapsed; //seconds spent executing, only tracked under a time limit
+	long long allocated; //net bytes allocated while executing, only tracked under a memory limit
 } Interpreter;
 
 void initInterpreter(Interpreter* interpreter, unsigned char* bytecode, int length);
+
+//execute already loaded code without taking ownership, the shared data is only ever read
+void initInterpreterShared(Interpreter* interpreter, LiteralArray* literalCache, LineTable* lines, unsigned char* bytecode, int length, int codeStart);
+
+//execute code that was never collated, such as from releaseCompiler(), taking ownership of all of it, so there's nothing to load
+void initInterpreterCode(Interpreter* interpreter, LiteralArray* literalCache, LineTable* lines, unsigned char* code, int length);
 void freeInterpreter(Interpreter* interpreter);
 
 //utilities for the host program
 void setInterpreterPrint(Interpreter* interpreter, PrintFn printOutput);
 void setInterpreterAssert(Interpreter* interpreter, PrintFn assertOutput);
+void setInterpreterError(Interpreter* interpreter, PrintFn errorOutput); //stderr by default
+void setInterpreterProfiler(Interpreter* interpreter, Profiler* profiler);
+
+//reads the header and data section, stopping at the start of the code section
+bool loadInterpreter(Interpreter* interpreter);
 
+//loads the bytecode if needed, then executes the code section
 void runInterpreter(Interpreter* interpreter);
+
+//like runInterpreter(), but stops after this many instructions or seconds (0 for no limit) and returns INTERPRETER_YIELDED
+//all of the state stays in the interpreter, so calling this again resumes where it left off, until it returns something else
+InterpreterStatus stepInterpreter(Interpreter* interpreter, unsigned long long budget, double seconds);
+
+//a message for the statuses that stop a run early, NULL otherwise
+const char* describeInterpreterStatus(InterpreterStatus status);
+
+//stop the run at its next check, with INTERPRETER_PREEMPTED, safe to call from any thread such as a watchdog
+void preemptInterpreter(Interpreter* interpreter);
+
+//executes raw code (no header or data section) against the interpreter's current state, the code is not retained
+//any literals appended to the array since the last call are copied first, so it must always be the same array, such as a live compiler's cache
+void runInterpreterCode(Interpreter* interpreter, LiteralArray* literals, unsigned char* code, int length);
@@ -1,32 +1,119 @@
 #include "lexer.h"
 #include "keyword_types.h"
 
+#include "memory.h"
+
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+
+#define LEXER_WINDOW (64 * 1024) //bytes read at a time when streaming
 
 //static generic utility functions
 static void cleanLexer(Lexer* lexer) {
 	lexer->source = NULL;
+	lexer->length = 0;
 	lexer->start = 0;
 	lexer->current = 0;
 	lexer->line = 1;
+	lexer->verbose = false;
+	lexer->fd = -1;
+	lexer->capacity = 0;
+	lexer->spare = NULL;
+	lexer->spareCapacity = 0;
+	lexer->swapped = false;
+}
+
+//read more of the stream into the window, keeping the token being scanned
+static void refill(Lexer* lexer) {
+	if (lexer->length == lexer->capacity) {
+		size_t keep = lexer->length - lexer->start;
+
+		if (lexer->start == 0) {
+			//this token fills the whole window, and nothing else is in it, so it can move
+			size_t oldCapacity = lexer->capacity;
+			lexer->capacity = oldCapacity * 2;
+			lexer->source = GROW_ARRAY(char, lexer->source, oldCapacity, lexer->capacity);
+		}
+		else if (lexer->swapped) {
+			//the previous token was left in the spare window earlier in this scan, so this one only holds what's been read since
+			memmove(lexer->source, &lexer->source[lexer->start], keep);
+
+			lexer->current -= lexer->start;
+			lexer->start = 0;
+			lexer->length = keep;
+		}
+		else {
+			//the previous token may still be in this window, so swap to the spare one
+			if (lexer->spareCapacity < keep + LEXER_WINDOW) {
+				size_t oldCapacity = lexer->spareCapacity;
+				lexer->spareCapacity = keep + LEXER_WINDOW;
+				lexer->spare = GROW_ARRAY(char, lexer->spare, oldCapacity, lexer->spareCapacity);
+			}
+
+			memcpy(lexer->spare, &lexer->source[lexer->start], keep);
+
+			char* window = lexer->source;
+			size_t capacity = lexer->capacity;
+
+			lexer->source = lexer->spare;
+			lexer->capacity = lexer->spareCapacity;
+			lexer->spare = window;
+			lexer->spareCapacity = capacity;
+
+			lexer->current -= lexer->start;
+			lexer->start = 0;
+			lexer->length = keep;
+
+			//swapping again before this scan is done would overwrite the previous token
+			lexer->swapped = true;
+		}
+	}
+
+	//whatever was printed so far is seen before waiting on the writer, which may be waiting on it
+	fflush(stdout);
+
+	ssize_t count;
+
+	do {
+		count = read(lexer->fd, &lexer->source[lexer->length], lexer->capacity - lexer->length);
+	} while (count < 0 && errno == EINTR);
+
+	if (count <= 0) {
+		lexer->fd = -1;
+		return;
+	}
+
+	lexer->length += count;
+}
+
+//make sure the character this far ahead has been read, and say whether there is one
+//it's only called once the window runs out, so lexing a string never leaves the checks below
+static bool fill(Lexer* lexer, size_t ahead) {
+	while (lexer->fd >= 0 && lexer->current + ahead >= lexer->length) {
+		refill(lexer);
+	}
+
+	return lexer->current + ahead < lexer->length;
 }
 
 static bool isAtEnd(Lexer* lexer) {
-	return lexer->source[lexer->current] == '\0';
+	return lexer->current >= lexer->length && !fill(lexer, 0);
 }
 
 static char peek(Lexer* lexer) {
+	if (lexer->current >= lexer->length && !fill(lexer, 0)) return '\0';
 	return lexer->source[lexer->current];
 }
 
 static char peekNext(Lexer* lexer) {
-	if (isAtEnd(lexer)) return '\0';
+	if (lexer->current + 1 >= lexer->length && !fill(lexer, 1)) return '\0';
 	return lexer->source[lexer->current + 1];
 }
 
 static char advance(Lexer* lexer) {
-	if (isAtEnd(lexer)) {
+	if (lexer->current >= lexer->length && !fill(lexer, 0)) {
 		return '\0';
 	}
 
@@ -40,40 +127,46 @@ static char advance(Lexer* lexer) {
 }
 
 static void eatWhitespace(Lexer* lexer) {
-	const char c = peek(lexer);
-
-	switch(c) {
-		case ' ':
-		case '\r':
-		case '\n':
-		case '\t':
-			advance(lexer);
-			break;
-
-		//comments
-		case '/':
-			//eat the line
-			if (peekNext(lexer) == '/') {
-				while (advance(lexer) != '\n' && !isAtEnd(lexer));
-				break;
-			}
-
-			//eat the block
-			if (peekNext(lexer) == '*') {
-				advance(lexer);
-				advance(lexer);
-				while(!(peek(lexer) == '*' && peekNext(lexer) == '/')) advance(lexer);
-				advance(lexer);
+	//a loop rather than tail recursion, which isn't guaranteed, so any amount of whitespace is fine
+	for (;;) {
+		const char c = peek(lexer);
+
+		switch(c) {
+			case ' ':
+			case '\r':
+			case '\n':
+			case '\t':
 				advance(lexer);
 				break;
-			}
 
-		default:
-			return;
-	}
+			//comments
+			case '/':
+				//eat the line
+				if (peekNext(lexer) == '/') {
+					while (advance(lexer) != '\n' && !isAtEnd(lexer)) lexer->start = lexer->current;
+					break;
+				}
+
+				//eat the block
+				if (peekNext(lexer) == '*') {
+					advance(lexer);
+					advance(lexer);
+					while(!(peek(lexer) == '*' && peekNext(lexer) == '/') && !isAtEnd(lexer)) {
+						advance(lexer);
+						lexer->start = lexer->current;
+					}
+					advance(lexer);
+					advance(lexer);
+					break;
+				}
+
+			default:
+				return;
+		}
 
-	//tail recursion
-	eatWhitespace(lexer);
+		//a stream doesn't need to keep what's been eaten
+		lexer->start = lexer->current;
+	}
 }
 
 static bool isDigit(Lexer* lexer) {
@@ -106,7 +199,7 @@ static Token makeErrorToken(Lexer* lexer, char* msg) {
 	token.length = strlen(msg);
 	token.line = lexer->line;
 
-	if (command.verbose) {
+	if (lexer->verbose) {
 		printf("err:");
 		printToken(&token);
 	}
@@ -122,7 +215,7 @@ static Token makeToken(Lexer* lexer, TokenType type) {
 	token.length = 1;
 	token.line = lexer->line;
 
-	if (command.verbose) {
+	if (lexer->verbose) {
 		printf("tok:");
 		printToken(&token);
 	}
@@ -148,7 +241,7 @@ static Token makeIntegerOrFloat(Lexer* lexer) {
 	token.length = lexer->current - lexer->start;
 	token.line = lexer->line;
 
-	if (command.verbose) {
+	if (lexer->verbose) {
 		if (type == TOKEN_LITERAL_INTEGER) {
 			printf("int:");
 		} else {
@@ -178,7 +271,7 @@ static Token makeString(Lexer* lexer, char terminator) {
 	token.length = lexer->current - lexer->start - 2;
 	token.line = lexer->line;
 
-	if (command.verbose) {
+	if (lexer->verbose) {
 		printf("str:");
 		printToken(&token);
 	}
@@ -203,7 +296,7 @@ static Token makeKeywordOrIdentifier(Lexer* lexer) {
 			token.length = lexer->current - lexer->start;
 			token.line = lexer->line;
 
-			if (command.verbose) {
+			if (lexer->verbose) {
 				printf("kwd:");
 				printToken(&token);
 			}
@@ -220,7 +313,7 @@ static Token makeKeywordOrIdentifier(Lexer* lexer) {
 	token.length = lexer->current - lexer->start;
 	token.line = lexer->line;
 
-	if (command.verbose) {
+	if (lexer->verbose) {
 		printf("idf:");
 		printToken(&token);
 	}
@@ -230,12 +323,41 @@ static Token makeKeywordOrIdentifier(Lexer* lexer) {
 
 //exposed functions
 void initLexer(Lexer* lexer, char* source) {
+	initLexerLength(lexer, source, strlen(source));
+}
+
+void initLexerLength(Lexer* lexer, char* source, size_t length) {
 	cleanLexer(lexer);
 
 	lexer->source = source;
+	lexer->length = length;
+}
+
+void initLexerStream(Lexer* lexer, int fd) {
+	cleanLexer(lexer);
+
+	//nothing is read until the first token is scanned
+	lexer->fd = fd;
+	lexer->capacity = LEXER_WINDOW;
+	lexer->source = ALLOCATE(char, lexer->capacity);
+	lexer->length = 0;
+}
+
+void freeLexer(Lexer* lexer) {
+	//the source of a string lexer belongs to the caller
+	if (lexer->capacity > 0) {
+		FREE_ARRAY(char, lexer->source, lexer->capacity);
+		FREE_ARRAY(char, lexer->spare, lexer->spareCapacity);
+	}
+
+	cleanLexer(lexer);
 }
 
 Token scanLexer(Lexer* lexer) {
+	//nothing before here is kept, so the last token is never moved by growing the window, even when it filled it
+	lexer->start = lexer->current;
+	lexer->swapped = false;
+
 	eatWhitespace(lexer);
 
 	lexer->start = lexer->current;
@@ -289,11 +411,9 @@ Token scanLexer(Lexer* lexer) {
 			return makeString(lexer, c);
 			//TODO: possibly support interpolated strings
 
-		default: {
-			char buffer[128];
-			snprintf(buffer, 128, "Unexpected token: %c", c);
-			return makeErrorToken(lexer, buffer);
-		}
+		default:
+			snprintf(lexer->message, sizeof(lexer->message), "Unexpected token: %c", c);
+			return makeErrorToken(lexer, lexer->message);
 	}
 }
 
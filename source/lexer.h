@@ -4,11 +4,22 @@
 #include "token_types.h"
 
 //lexers are bound to a string of code, and return a single token every time scan is called
+//a streaming lexer reads its code into a window as it goes, and a token stays valid until the one after next is scanned
 typedef struct {
-	char* source;
-	int start; //start of the token
-	int current; //current position of the lexer
+	char* source; //doesn't need to be terminated, nothing past length is read
+	size_t length;
+	size_t start; //start of the token
+	size_t current; //current position of the lexer
 	int line; //track this for error handling
+	bool verbose; //print each token as it's scanned
+	char message[64]; //for error tokens that need one formatted, valid until the next scan
+
+	//streaming only, the positions above are within the window
+	int fd; //where more code comes from, -1 once it runs out
+	size_t capacity; //of the window
+	char* spare; //the last window, the previous token can still be in it
+	size_t spareCapacity;
+	bool swapped; //the spare window was taken during this scan
 } Lexer;
 
 //tokens are intermediaries between lexers and parsers
@@ -19,7 +30,10 @@ typedef struct {
 	int line;
 } Token;
 
-void initLexer(Lexer* lexer, char* source);
+void initLexer(Lexer* lexer, char* source); //source is terminated with '\0'
+void initLexerLength(Lexer* lexer, char* source, size_t length);
+void initLexerStream(Lexer* lexer, int fd); //such as a pipe, the lexer only blocks when it needs more code
+void freeLexer(Lexer* lexer); //only streaming lexers own any memory
 Token scanLexer(Lexer* lexer);
 
 void printToken(Token* token);
\ No newline at end of file
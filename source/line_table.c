@@ -0,0 +1,64 @@
+#include "line_table.h"
+
+#include "memory.h"
+
+void initLineTable(LineTable* table) {
+	table->capacity = 0;
+	table->count = 0;
+	table->offsets = NULL;
+	table->lines = NULL;
+}
+
+void pushLineTable(LineTable* table, int offset, int line) {
+	if (table->count > 0) {
+		//same line, nothing new to record
+		if (table->lines[table->count - 1] == line) {
+			return;
+		}
+
+		//nothing was emitted for the previous line, so replace it
+		if (table->offsets[table->count - 1] == offset) {
+			table->lines[table->count - 1] = line;
+			return;
+		}
+	}
+
+	if (table->capacity < table->count + 1) {
+		int oldCapacity = table->capacity;
+
+		table->capacity = GROW_CAPACITY(oldCapacity);
+		table->offsets = GROW_ARRAY(int, table->offsets, oldCapacity, table->capacity);
+		table->lines = GROW_ARRAY(int, table->lines, oldCapacity, table->capacity);
+	}
+
+	table->offsets[table->count] = offset;
+	table->lines[table->count] = line;
+	table->count++;
+}
+
+void freeLineTable(LineTable* table) {
+	FREE_ARRAY(int, table->offsets, table->capacity);
+	FREE_ARRAY(int, table->lines, table->capacity);
+	initLineTable(table);
+}
+
+int findLineTable(LineTable* table, int offset) {
+	//binary search for the last entry at or before the offset
+	int lo = 0;
+	int hi = table->count - 1;
+	int line = 0;
+
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (table->offsets[mid] <= offset) {
+			line = table->lines[mid];
+			lo = mid + 1;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+
+	return line;
+}
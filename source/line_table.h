@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common.h"
+
+//maps offsets in the code section to source lines, each entry covers the code up to the next entry
+typedef struct LineTable {
+	int capacity;
+	int count;
+	int* offsets; //ascending
+	int* lines;
+} LineTable;
+
+void initLineTable(LineTable* table);
+void pushLineTable(LineTable* table, int offset, int line);
+void freeLineTable(LineTable* table);
+
+//returns 0 if the offset precedes every entry
+int findLineTable(LineTable* table, int offset);
@@ -13,45 +13,47 @@ void printLiteral(Literal literal) {
 }
 
 void printLiteralCustom(Literal literal, void (printFn)(const char*)) {
+	char buffer[256];
+
+	if (!formatLiteral(literal, buffer, 256)) {
+		//should never bee seen
+		fprintf(stderr, "[Internal] Unrecognized literal type: %d", literal.type);
+		return;
+	}
+
+	printFn(buffer);
+}
+
+bool formatLiteral(Literal literal, char* buffer, int size) {
 	switch(literal.type) {
 		case LITERAL_NULL:
-			printFn("null");
-		break;
+			snprintf(buffer, size, "null");
+			return true;
 
 		case LITERAL_BOOLEAN:
-			printFn(AS_BOOLEAN(literal) ? "true" : "false");
-		break;
-
-		case LITERAL_INTEGER: {
-			char buffer[256];
-			snprintf(buffer, 256, "%d", AS_INTEGER(literal));
-			printFn(buffer);
-		}
-		break;
-
-		case LITERAL_FLOAT: {
-			char buffer[256];
-			snprintf(buffer, 256, "%g", AS_FLOAT(literal));
-			printFn(buffer);
-		}
-		break;
-
-		case LITERAL_STRING: {
-			char buffer[256];
-			snprintf(buffer, 256, "%.*s", STRLEN(literal), AS_STRING(literal));
-			printFn(buffer);
-		}
-		break;
+			snprintf(buffer, size, "%s", AS_BOOLEAN(literal) ? "true" : "false");
+			return true;
+
+		case LITERAL_INTEGER:
+			snprintf(buffer, size, "%d", AS_INTEGER(literal));
+			return true;
+
+		case LITERAL_FLOAT:
+			snprintf(buffer, size, "%g", AS_FLOAT(literal));
+			return true;
+
+		case LITERAL_STRING:
+			snprintf(buffer, size, "%.*s", STRLEN(literal), AS_STRING(literal));
+			return true;
 
 		default:
-			//should never bee seen
-			fprintf(stderr, "[Internal] Unrecognized literal type: %d", literal.type);
+			return false;
 	}
 }
 
 void freeLiteral(Literal literal) {
 	if (IS_STRING(literal)) {
-		FREE(char, AS_STRING(literal));
+		FREE_ARRAY(char, AS_STRING(literal), STRLEN(literal) + 1);
 		return;
 	}
 }
@@ -61,6 +61,7 @@ typedef struct {
 
 void printLiteral(Literal literal);
 void printLiteralCustom(Literal literal, void (printFn)(const char*));
+bool formatLiteral(Literal literal, char* buffer, int size); //as it would be printed, cut short to fit, false for an unrecognized type
 void freeLiteral(Literal literal);
 
 #define IS_TRUTHY(x) _isTruthy(x)
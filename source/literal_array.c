@@ -40,60 +40,165 @@ Literal popLiteralArray(LiteralArray* array) {
 	return ret;
 }
 
-void freeLiteralArray(LiteralArray* array) {
-	//clean up memory
+void clearLiteralArray(LiteralArray* array) {
 	for(int i = 0; i < array->count; i++) {
 		freeLiteral(array->literals[i]);
 	}
 
+	array->count = 0;
+}
+
+void freeLiteralArray(LiteralArray* array) {
+	//clean up memory
+	clearLiteralArray(array);
+
 	FREE_ARRAY(Literal, array->literals, array->capacity);
 	initLiteralArray(array);
 }
 
+static bool matchLiteral(Literal lhs, Literal rhs) {
+	//not the same type
+	if (lhs.type != rhs.type) {
+		return false;
+	}
+
+	//matching type, compare values
+	switch(lhs.type) {
+		case LITERAL_NULL:
+			return true;
+
+		case LITERAL_BOOLEAN:
+			return AS_BOOLEAN(lhs) == AS_BOOLEAN(rhs);
+
+		case LITERAL_INTEGER:
+			return AS_INTEGER(lhs) == AS_INTEGER(rhs);
+
+		case LITERAL_FLOAT:
+			return AS_FLOAT(lhs) == AS_FLOAT(rhs);
+
+		case LITERAL_STRING:
+			//BUGFIX: compare the lengths too, or a string matches any longer string it's a prefix of
+			return STRLEN(lhs) == STRLEN(rhs) && memcmp(AS_STRING(lhs), AS_STRING(rhs), STRLEN(rhs)) == 0;
+
+		default:
+			fprintf(stderr, "[Internal] Unexpected literal type in findLiteralIndex(): %d\n", rhs.type);
+			return false;
+	}
+}
+
 //find a literal in the array that matches the "literal" argument
 int findLiteralIndex(LiteralArray* array, Literal literal) {
 	for (int i = 0; i < array->count; i++) {
-		//not the same type
-		if (array->literals[i].type != literal.type) {
-			continue;
+		if (matchLiteral(array->literals[i], literal)) {
+			return i;
 		}
+	}
+
+	return -1;
+}
+
+//literals that match must hash the same, so 0 and -0 share a hash
+static unsigned int hashLiteral(Literal literal) {
+	unsigned int hash = 2166136261u; //FNV-1a
+
+	switch(literal.type) {
+		case LITERAL_BOOLEAN:
+			hash = (hash ^ AS_BOOLEAN(literal)) * 16777619u;
+		break;
+
+		case LITERAL_INTEGER:
+			hash = (hash ^ (unsigned int)AS_INTEGER(literal)) * 16777619u;
+		break;
 
-		//matching type, compare values
-		switch(array->literals[i].type) {
-			case LITERAL_NULL:
-				return i;
-
-			case LITERAL_BOOLEAN:
-				if (AS_BOOLEAN(array->literals[i]) == AS_BOOLEAN(literal)) {
-					return i;
-				}
-			continue;
-
-			case LITERAL_INTEGER:
-				if (AS_INTEGER(array->literals[i]) == AS_INTEGER(literal)) {
-					return i;
-				}
-			continue;
-
-			case LITERAL_FLOAT:
-				if (AS_FLOAT(array->literals[i]) == AS_FLOAT(literal)) {
-					return i;
-				}
-			continue;
-
-			case LITERAL_STRING:
-				if (strncmp(AS_STRING(array->literals[i]), AS_STRING(literal), STRLEN(literal)) == 0) {
-					return i;
-				}
-
-			continue;
-
-			default:
-				fprintf(stderr, "[Internal] Unexpected literal type in findLiteralIndex(): %d\n", literal.type);
+		case LITERAL_FLOAT: {
+			float number = AS_FLOAT(literal) == 0 ? 0 : AS_FLOAT(literal);
+			unsigned int bits = 0;
+			memcpy(&bits, &number, sizeof(bits));
+			hash = (hash ^ bits) * 16777619u;
 		}
+		break;
+
+		case LITERAL_STRING:
+			for (int i = 0; i < STRLEN(literal); i++) {
+				hash = (hash ^ (unsigned char)AS_STRING(literal)[i]) * 16777619u;
+			}
+		break;
+
+		default:
+		break;
 	}
 
-	return -1;
+	return (hash ^ literal.type) * 16777619u;
+}
+
+void initLiteralIndex(LiteralIndex* index) {
+	index->capacity = 0;
+	index->count = 0;
+	index->slots = NULL;
+}
+
+void clearLiteralIndex(LiteralIndex* index) {
+	if (index->capacity > 0) {
+		memset(index->slots, 0, sizeof(int) * index->capacity);
+	}
+
+	index->count = 0;
+}
+
+void freeLiteralIndex(LiteralIndex* index) {
+	FREE_ARRAY(int, index->slots, index->capacity);
+	initLiteralIndex(index);
+}
+
+static void insertLiteralIndex(LiteralIndex* index, LiteralArray* array, int position) {
+	unsigned int slot = hashLiteral(array->literals[position]) & (index->capacity - 1);
+
+	//linear probing
+	while (index->slots[slot] != 0) {
+		slot = (slot + 1) & (index->capacity - 1);
+	}
+
+	index->slots[slot] = position + 1;
+	index->count++;
+}
+
+int internLiteralArray(LiteralArray* array, LiteralIndex* index, Literal literal) {
+	if (index->capacity > 0) {
+		unsigned int slot = hashLiteral(literal) & (index->capacity - 1);
+
+		while (index->slots[slot] != 0) {
+			if (matchLiteral(array->literals[index->slots[slot] - 1], literal)) {
+				return index->slots[slot] - 1;
+			}
+
+			slot = (slot + 1) & (index->capacity - 1);
+		}
+	}
+
+	int position = pushLiteralArray(array, literal);
+
+	//keep the table at most half full
+	if (index->capacity < (index->count + 1) * 2) {
+		int oldCapacity = index->capacity;
+		int* oldSlots = index->slots;
+
+		index->capacity = GROW_CAPACITY(oldCapacity);
+		index->slots = ALLOCATE(int, index->capacity);
+		index->count = 0;
+		memset(index->slots, 0, sizeof(int) * index->capacity);
+
+		for (int i = 0; i < oldCapacity; i++) {
+			if (oldSlots[i] != 0) {
+				insertLiteralIndex(index, array, oldSlots[i] - 1);
+			}
+		}
+
+		FREE_ARRAY(int, oldSlots, oldCapacity);
+	}
+
+	insertLiteralIndex(index, array, position);
+
+	return position;
 }
 
 void printLiteralArray(LiteralArray* array, const char* delim) {
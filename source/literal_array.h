@@ -11,8 +11,24 @@ typedef struct LiteralArray {
 void initLiteralArray(LiteralArray* array);
 int pushLiteralArray(LiteralArray* array, Literal literal);
 Literal popLiteralArray(LiteralArray* array);
+void clearLiteralArray(LiteralArray* array); //keeps the storage
 void freeLiteralArray(LiteralArray* array);
 
 int findLiteralIndex(LiteralArray* array, Literal literal);
 
+//a hash table over a literal array, so a literal can be found without searching the whole array
+//it matches literals exactly the way findLiteralIndex() does, so either one builds the same array
+typedef struct LiteralIndex {
+	int capacity; //always a power of two
+	int count;
+	int* slots; //positions in the array plus one, 0 when empty
+} LiteralIndex;
+
+void initLiteralIndex(LiteralIndex* index);
+void clearLiteralIndex(LiteralIndex* index); //keeps the storage, for when its array is cleared
+void freeLiteralIndex(LiteralIndex* index);
+
+//returns the position of a matching literal, pushing it first if there isn't one
+int internLiteralArray(LiteralArray* array, LiteralIndex* index, Literal literal);
+
 void printLiteralArray(LiteralArray* array, const char* delim);
\ No newline at end of file
@@ -3,7 +3,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+static _Thread_local MemoryStats memoryStats;
+
 void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
+	//track the calling thread's usage
+	if (newSize > oldSize) {
+		memoryStats.allocations++;
+		memoryStats.bytes += newSize - oldSize;
+	}
+
+	memoryStats.current += (long long)newSize - (long long)oldSize;
+
+	if (memoryStats.current > memoryStats.peak) {
+		memoryStats.peak = memoryStats.current;
+	}
+
 	if (newSize == 0) {
 		free(pointer);
 
@@ -13,10 +27,17 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
 	void* mem = realloc(pointer, newSize);
 
 	if (mem == NULL) {
-		fprintf(stderr, "[Internal]Memory allocation error (requested %d for %d, replacing %d)\n", (int)newSize, (int)pointer, (int)oldSize);
+		fprintf(stderr, "[Internal]Memory allocation error (requested %zu for %p, replacing %zu)\n", newSize, pointer, oldSize);
 		exit(-1);
 	}
 
 	return mem;
 }
 
+MemoryStats getMemoryStats() {
+	return memoryStats;
+}
+
+void resetMemoryPeak() {
+	memoryStats.peak = memoryStats.current;
+}
@@ -11,3 +11,13 @@
 
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
 
+//allocation statistics, tracked separately for each thread
+typedef struct MemoryStats {
+	unsigned long long allocations; //calls that allocated or grew a block
+	unsigned long long bytes; //total bytes requested by those calls
+	long long current; //bytes currently live
+	long long peak; //highest value of current since the last reset
+} MemoryStats;
+
+MemoryStats getMemoryStats();
+void resetMemoryPeak();
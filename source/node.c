@@ -4,95 +4,151 @@
 
 #include <stdio.h>
 
-void freeNode(Node* node) {
-	//don't free a NULL node
-	if (node == NULL) {
-		return;
+void initNodeArray(NodeArray* array) {
+	array->capacity = 0;
+	array->count = 0;
+	array->nodes = NULL;
+	array->literalCapacity = 0;
+	array->literalCount = 0;
+	array->literals = NULL;
+}
+
+void clearNodeArray(NodeArray* array) {
+	for (int i = 0; i < array->literalCount; i++) {
+		freeLiteral(array->literals[i]);
 	}
 
-	switch(node->type) {
-		case NODE_LITERAL:
-			freeLiteral(node->atomic.literal);
-			break;
+	array->count = 0;
+	array->literalCount = 0;
+}
 
-		case NODE_UNARY:
-			freeNode(node->unary.child);
-			break;
+void freeNodeArray(NodeArray* array) {
+	clearNodeArray(array);
+
+	FREE_ARRAY(Node, array->nodes, array->capacity);
+	FREE_ARRAY(Literal, array->literals, array->literalCapacity);
+	initNodeArray(array);
+}
 
-		case NODE_BINARY:
-			freeNode(node->binary.left);
-			freeNode(node->binary.right);
-			break;
+static NodeIndex pushNode(NodeArray* array, NodeType type, Opcode opcode, NodeIndex operand) {
+	if (array->capacity < array->count + 1) {
+		int oldCapacity = array->capacity;
 
-		case NODE_GROUPING:
-			freeNode(node->grouping.child);
-			break;
+		array->capacity = GROW_CAPACITY(oldCapacity);
+		array->nodes = GROW_ARRAY(Node, array->nodes, oldCapacity, array->capacity);
 	}
 
-	FREE(Node, node);
+	array->nodes[array->count] = (Node){ type, opcode, operand };
+	return array->count++;
 }
 
-void emitNodeLiteral(Node** nodeHandle, Literal literal) {
-	//allocate a new node
-	*nodeHandle = ALLOCATE(Node, 1);
+NodeIndex pushNodeLiteral(NodeArray* array, Literal literal) {
+	if (array->literalCapacity < array->literalCount + 1) {
+		int oldCapacity = array->literalCapacity;
 
-	(*nodeHandle)->type = NODE_LITERAL;
-	(*nodeHandle)->atomic.literal = literal;
+		array->literalCapacity = GROW_CAPACITY(oldCapacity);
+		array->literals = GROW_ARRAY(Literal, array->literals, oldCapacity, array->literalCapacity);
+	}
+
+	array->literals[array->literalCount] = literal;
+	return pushNode(array, NODE_LITERAL, OP_EOF, array->literalCount++);
 }
 
-void emitNodeUnary(Node** nodeHandle, Opcode opcode) {
-	//allocate a new node
-	*nodeHandle = ALLOCATE(Node, 1);
+NodeIndex pushNodeUnary(NodeArray* array, Opcode opcode) {
+	return pushNode(array, NODE_UNARY, opcode, 0);
+}
 
-	(*nodeHandle)->type = NODE_UNARY;
-	(*nodeHandle)->unary.opcode = opcode;
-	(*nodeHandle)->unary.child = NULL;
+NodeIndex pushNodeBinary(NodeArray* array, NodeIndex left, Opcode opcode) {
+	return pushNode(array, NODE_BINARY, opcode, left);
 }
 
-void emitNodeBinary(Node** nodeHandle, Node* rhs, Opcode opcode) {
-	Node* tmp = ALLOCATE(Node, 1);
+NodeIndex pushNodeGroupingBegin(NodeArray* array) {
+	return pushNode(array, NODE_GROUPING_BEGIN, OP_EOF, 0);
+}
 
-	tmp->type = NODE_BINARY;
-	tmp->binary.opcode = opcode;
-	tmp->binary.left = *nodeHandle;
-	tmp->binary.right = rhs;
+NodeIndex pushNodeGrouping(NodeArray* array) {
+	return pushNode(array, NODE_GROUPING, OP_EOF, 0);
+}
+
+void foldNodeArray(NodeArray* array, NodeIndex index, Literal literal) {
+	//the literals are in the same order as the nodes, so the discarded ones are at the end too
+	for (int i = index; i < array->count; i++) {
+		if (array->nodes[i].type == NODE_LITERAL) {
+			freeLiteral(array->literals[--array->literalCount]);
+		}
+	}
 
-	*nodeHandle = tmp;
+	array->count = index;
+	pushNodeLiteral(array, literal);
 }
 
-void emitNodeGrouping(Node** nodeHandle) {
-	Node* tmp = ALLOCATE(Node, 1);
+//nodes can nest as deep as the parser allows, so the work left to do is kept on a stack of its own
+typedef struct PrintStep {
+	const char* text; //printed when not NULL, otherwise the node is visited
+	NodeIndex index;
+} PrintStep;
+
+typedef struct PrintStack {
+	int capacity;
+	int count;
+	PrintStep* steps;
+} PrintStack;
 
-	tmp->type = NODE_GROUPING;
-	tmp->grouping.child = NULL;
+static void pushPrintStep(PrintStack* stack, const char* text, NodeIndex index) {
+	if (stack->capacity < stack->count + 1) {
+		int oldCapacity = stack->capacity;
 
-	*nodeHandle = tmp;
+		stack->capacity = GROW_CAPACITY(oldCapacity);
+		stack->steps = GROW_ARRAY(PrintStep, stack->steps, oldCapacity, stack->capacity);
+	}
+
+	stack->steps[stack->count++] = (PrintStep){ text, index };
 }
 
-void printNode(Node* node) {
-	switch(node->type) {
-		case NODE_LITERAL:
-			printf("literal:");
-			printLiteral(node->atomic.literal);
-			break;
-
-		case NODE_UNARY:
-			printf("unary:");
-			printNode(node->unary.child);
-			break;
-
-		case NODE_BINARY:
-			printf("binary-left:");
-			printNode(node->binary.left);
-			printf("binary-right:");
-			printNode(node->binary.right);
-			printf(";");
-			break;
-
-		case NODE_GROUPING:
-			printf("(");
-			printNode(node->grouping.child);
-			printf(")");
-			break;
+void printNode(NodeArray* array, NodeIndex index) {
+	PrintStack stack = { 0, 0, NULL };
+	pushPrintStep(&stack, NULL, index);
+
+	//the steps are pushed in reverse, so they're popped in order
+	while (stack.count > 0) {
+		PrintStep step = stack.steps[--stack.count];
+
+		if (step.text != NULL) {
+			printf("%s", step.text);
+			continue;
+		}
+
+		Node* node = &array->nodes[step.index];
+
+		switch(node->type) {
+			case NODE_LITERAL:
+				printf("literal:");
+				printLiteral(array->literals[node->operand]);
+				break;
+
+			case NODE_UNARY:
+				printf("unary:");
+				pushPrintStep(&stack, NULL, step.index - 1);
+				break;
+
+			case NODE_BINARY:
+				printf("binary-left:");
+				pushPrintStep(&stack, ";", 0);
+				pushPrintStep(&stack, NULL, step.index - 1);
+				pushPrintStep(&stack, "binary-right:", 0);
+				pushPrintStep(&stack, NULL, node->operand);
+				break;
+
+			case NODE_GROUPING_BEGIN:
+				break;
+
+			case NODE_GROUPING:
+				printf("(");
+				pushPrintStep(&stack, ")", 0);
+				pushPrintStep(&stack, NULL, step.index - 1);
+				break;
+		}
 	}
-}
\ No newline at end of file
+
+	FREE_ARRAY(PrintStep, stack.steps, stack.capacity);
+}
@@ -4,52 +4,45 @@
 #include "opcodes.h"
 
 //nodes are the intermediaries between parsers and compilers
-typedef union _node Node;
+//they're stored flat and in post-order, so children always come before their parents, and compiling is a single pass from start to end
+typedef unsigned int NodeIndex;
 
 typedef enum NodeType {
-	NODE_ERROR,
 	NODE_LITERAL, //a simple value
-	NODE_UNARY, //one child
-	NODE_BINARY, //two children, left and right
-	NODE_GROUPING, //one child
+	NODE_UNARY, //one child, the previous node
+	NODE_BINARY, //two children, left and right, the previous node is the right
+	NODE_GROUPING_BEGIN, //marks where a grouping starts, has no children
+	NODE_GROUPING, //one child, the previous node
 } NodeType;
 
-typedef struct NodeLiteral {
-	NodeType type;
-	Literal literal;
-} NodeLiteral;
-
-typedef struct NodeUnary {
-	NodeType type;
-	Opcode opcode;
-	Node* child;
-} NodeUnary;
-
-typedef struct NodeBinary {
-	NodeType type;
-	Opcode opcode;
-	Node* left;
-	Node* right;
-} NodeBinary;
-
-typedef struct NodeGrouping {
-	NodeType type;
-	Node* child;
-} NodeGrouping;
-
-union _node {
-	NodeType type;
-	NodeLiteral atomic;
-	NodeUnary unary;
-	NodeBinary binary;
-	NodeGrouping grouping;
-};
-
-void freeNode(Node* node);
-void emitNodeLiteral(Node** nodeHandle, Literal literal);
-void emitNodeUnary(Node** nodeHandle, Opcode opcode);
-void emitNodeBinary(Node** nodeHandle, Node* rhs, Opcode opcode);
-void emitNodeGrouping(Node** nodeHandle);
-
-void printNode(Node* node);
-
+typedef struct Node {
+	unsigned char type;
+	unsigned char opcode; //unary and binary only
+	NodeIndex operand; //literal: the index in the array's literals, binary: the index of the left child
+} Node;
+
+//the literals live beside the nodes, in the same order, to keep the nodes small
+typedef struct NodeArray {
+	int capacity;
+	int count;
+	Node* nodes;
+	int literalCapacity;
+	int literalCount;
+	Literal* literals;
+} NodeArray;
+
+void initNodeArray(NodeArray* array);
+void clearNodeArray(NodeArray* array); //keeps the storage for the next statement
+void freeNodeArray(NodeArray* array);
+
+//the array takes ownership of the literal
+NodeIndex pushNodeLiteral(NodeArray* array, Literal literal);
+NodeIndex pushNodeUnary(NodeArray* array, Opcode opcode);
+NodeIndex pushNodeBinary(NodeArray* array, NodeIndex left, Opcode opcode);
+NodeIndex pushNodeGroupingBegin(NodeArray* array);
+NodeIndex pushNodeGrouping(NodeArray* array);
+
+//replace every node from index to the end of the array with one literal
+void foldNodeArray(NodeArray* array, NodeIndex index, Literal literal);
+
+void printNode(NodeArray* array, NodeIndex index);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "common.h"
+
+//DOCS: numeric literals are read straight from the lexeme's span, which doesn't need to be terminated
+//the span must be what the lexer scans as a number, digits with at most one '.', so there's no sign, exponent or locale to handle
+//integers are accumulated digit by digit, and floats are rounded correctly by the Eisel-Lemire algorithm, with strtof() for the few it can't decide
+
+//returns false if the value doesn't fit in an int
+bool spanToInteger(const char* span, int length, int* value);
+
+//the same, but the value is negated, so the span can be one more than INT_MAX
+bool spanToNegativeInteger(const char* span, int length, int* value);
+
+float spanToFloat(const char* span, int length);
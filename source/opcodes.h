@@ -9,7 +9,11 @@ typedef enum Opcode {
 
 	//data
 	OP_LITERAL,
-	OP_LITERAL_LONG, //for more than 256 literals in a chunk
+	OP_LITERAL_LONG, //for more than 256 literals in a chunk, the index is a varint
+	OP_LITERAL_NULL, //immediate values, these don't touch the literal cache
+	OP_LITERAL_TRUE,
+	OP_LITERAL_FALSE,
+	OP_LITERAL_INTEGER, //followed by a signed byte
 
 	//operators
 	OP_NEGATE,
@@ -0,0 +1,262 @@
+#include "parallel.h"
+
+#include "lexer.h"
+#include "parser.h"
+
+#include "memory.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define PARALLEL_CHUNK_MIN (64 * 1024) //smaller chunks cost more to hand around than they save
+#define PARALLEL_CHUNKS_PER_JOB 4 //so one slow chunk doesn't hold up the rest
+
+typedef struct ParallelChunk {
+	char* source; //points into the whole source
+	size_t length;
+	int line; //where the chunk starts in the whole source
+	Compiler compiler;
+	bool error;
+	bool done;
+} ParallelChunk;
+
+typedef struct ParallelPool {
+	ParallelChunk* chunks;
+	int capacity;
+	int count;
+	int next; //the next chunk a worker should take
+	int optimize;
+	bool lines;
+
+	pthread_mutex_t lock;
+	pthread_cond_t finished; //signalled whenever a chunk is done
+} ParallelPool;
+
+//the same loop the toy executable runs over a whole source, returns false on a parse error
+static bool compileChunk(Compiler* compiler, char* source, size_t length, int line, int optimize, bool lines, bool quiet) {
+	Lexer lexer;
+	Parser parser;
+
+	initLexerLength(&lexer, source, length);
+	lexer.line = line;
+	initParser(&parser, &lexer);
+	parser.optimize = optimize;
+	parser.quiet = quiet;
+
+	if (optimize == 0) {
+		while (!parser.error) {
+			if (lines && parser.current.type != TOKEN_EOF) {
+				markCompilerLine(compiler, findParserLine(&parser, parser.current));
+			}
+
+			if (!writeParser(&parser, compiler)) {
+				break;
+			}
+		}
+	}
+	else {
+		NodeArray nodes;
+		initNodeArray(&nodes);
+
+		while(scanParser(&parser, &nodes) && !parser.error) {
+			if (lines) {
+				markCompilerLine(compiler, findParserLine(&parser, parser.statement));
+			}
+
+			writeCompiler(compiler, &nodes);
+			clearNodeArray(&nodes);
+		}
+
+		freeNodeArray(&nodes);
+	}
+
+	bool error = parser.error;
+	freeParser(&parser);
+
+	return !error;
+}
+
+static void pushChunk(ParallelPool* pool, char* source, size_t length, int line) {
+	if (pool->capacity < pool->count + 1) {
+		int oldCapacity = pool->capacity;
+
+		pool->capacity = GROW_CAPACITY(oldCapacity);
+		pool->chunks = GROW_ARRAY(ParallelChunk, pool->chunks, oldCapacity, pool->capacity);
+	}
+
+	ParallelChunk* chunk = &pool->chunks[pool->count++];
+
+	chunk->source = source;
+	chunk->length = length;
+	chunk->line = line;
+	initCompiler(&chunk->compiler);
+	chunk->error = false;
+	chunk->done = false;
+}
+
+static void freePool(ParallelPool* pool) {
+	for (int i = 0; i < pool->count; i++) {
+		freeCompiler(&pool->chunks[i].compiler);
+	}
+
+	FREE_ARRAY(ParallelChunk, pool->chunks, pool->capacity);
+	pool->chunks = NULL;
+	pool->capacity = 0;
+	pool->count = 0;
+}
+
+//a statement never spans a semicolon, so cutting just after one is always safe, returns false if the lexer rejects the source
+static bool splitSource(ParallelPool* pool, char* source, size_t length, size_t target) {
+	TRACE_BEGIN("parallel", "split");
+
+	Lexer lexer;
+	initLexerLength(&lexer, source, length);
+
+	size_t start = 0;
+	int line = 1;
+
+	for (;;) {
+		Token token = scanLexer(&lexer);
+
+		if (token.type == TOKEN_ERROR) {
+			TRACE_END("parallel", "split");
+			return false;
+		}
+
+		if (token.type == TOKEN_EOF) {
+			break;
+		}
+
+		if (token.type == TOKEN_SEMICOLON && lexer.current - start >= target) {
+			pushChunk(pool, &source[start], lexer.current - start, line);
+			start = lexer.current;
+			line = lexer.line;
+		}
+	}
+
+	pushChunk(pool, &source[start], length - start, line);
+
+	TRACE_END("parallel", "split");
+	return true;
+}
+
+static void* runWorker(void* arg) {
+	ParallelPool* pool = (ParallelPool*)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		int index = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (index >= pool->count) {
+			return NULL;
+		}
+
+		ParallelChunk* chunk = &pool->chunks[index];
+
+		//errors are reported later, in order, by the calling thread
+		TRACE_BEGIN_VALUE("parallel", "chunk", "index", index);
+		chunk->error = !compileChunk(&chunk->compiler, chunk->source, chunk->length, chunk->line, pool->optimize, pool->lines, true);
+		TRACE_END("parallel", "chunk");
+
+		pthread_mutex_lock(&pool->lock);
+		chunk->done = true;
+		pthread_cond_broadcast(&pool->finished);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+bool writeParallel(Compiler* compiler, char* source, size_t length, int optimize, bool lines, int jobs) {
+	if (jobs <= 0) {
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	size_t target = length / (jobs * PARALLEL_CHUNKS_PER_JOB);
+
+	if (target < PARALLEL_CHUNK_MIN) {
+		target = PARALLEL_CHUNK_MIN;
+	}
+
+	//not worth splitting
+	if (jobs == 1 || length < target * 2) {
+		return compileChunk(compiler, source, length, 1, optimize, lines, false);
+	}
+
+	ParallelPool pool;
+
+	pool.chunks = NULL;
+	pool.capacity = 0;
+	pool.count = 0;
+	pool.next = 0;
+	pool.optimize = optimize;
+	pool.lines = lines;
+
+	//let the sequential compile report whatever the lexer found
+	if (!splitSource(&pool, source, length, target) || pool.count < 2) {
+		freePool(&pool);
+		return compileChunk(compiler, source, length, 1, optimize, lines, false);
+	}
+
+	if (jobs > pool.count) {
+		jobs = pool.count;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.finished, NULL);
+
+	pthread_t* workers = ALLOCATE(pthread_t, jobs);
+
+	for (int i = 0; i < jobs; i++) {
+		pthread_create(&workers[i], NULL, runWorker, &pool);
+	}
+
+	//append each chunk in order, while later chunks are still compiling
+	int failed = -1;
+
+	for (int i = 0; i < pool.count; i++) {
+		ParallelChunk* chunk = &pool.chunks[i];
+
+		pthread_mutex_lock(&pool.lock);
+		while (!chunk->done) {
+			pthread_cond_wait(&pool.finished, &pool.lock);
+		}
+		pthread_mutex_unlock(&pool.lock);
+
+		if (chunk->error) {
+			//nothing after the first error matters, so stop handing out chunks
+			pthread_mutex_lock(&pool.lock);
+			pool.next = pool.count;
+			pthread_mutex_unlock(&pool.lock);
+
+			failed = i;
+			break;
+		}
+
+		appendCompiler(compiler, &chunk->compiler);
+
+		//done with it, so free it early
+		freeCompiler(&chunk->compiler);
+	}
+
+	for (int i = 0; i < jobs; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	FREE_ARRAY(pthread_t, workers, jobs);
+
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.finished);
+
+	//the code before the failed chunk matches the sequential compile, so compiling it again loudly reports the same error
+	if (failed >= 0) {
+		Compiler scratch;
+		initCompiler(&scratch);
+		compileChunk(&scratch, pool.chunks[failed].source, pool.chunks[failed].length, pool.chunks[failed].line, optimize, lines, false);
+		freeCompiler(&scratch);
+	}
+
+	freePool(&pool);
+
+	return failed < 0;
+}
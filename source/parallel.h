@@ -0,0 +1,13 @@
+#pragma once
+
+#include "common.h"
+#include "compiler.h"
+
+//DOCS: a large source can be compiled across a pool of worker threads, by splitting it into chunks at statement boundaries
+//each chunk is lexed, parsed and compiled into its own compiler, then appended in order, so the bytecode is identical to compiling on one thread
+//small sources, and ones the lexer rejects, are compiled on the calling thread instead
+
+//returns false on a parse error, after reporting the same error the sequential compile would, and the compiler's code should be thrown away
+//lines marks each statement's line in the compiler, the way the toy executable does for the debug section
+//the source doesn't need to be terminated, nothing past length is read
+bool writeParallel(Compiler* compiler, char* source, size_t length, int optimize, bool lines, int jobs);
@@ -4,16 +4,40 @@
 
 #include "memory.h"
 #include "literal.h"
+#include "number.h"
 #include "opcodes.h"
+#include "trace.h"
 
 #include <stdio.h>
 
+#define PARSER_ERROR_LEXEME 64 //longer lexemes are cut short in reports sent to errorOutput
+
 //utility functions
 static void error(Parser* parser, Token token, const char* message) {
 	//keep going while panicing
 	if (parser->panic) return;
 
-	fprintf(stderr, "[Line %d] Error", token.line);
+	parser->error = true;
+	parser->panic = true;
+
+	if (parser->quiet) return;
+
+	//the same report, as one string
+	if (parser->errorOutput != NULL) {
+		char buffer[PARSER_ERROR_LEXEME + 256];
+
+		if (token.type == TOKEN_EOF) {
+			snprintf(buffer, sizeof(buffer), "[Line %d] Error at end: %s\n", findParserLine(parser, token), message);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "[Line %d] Error at '%.*s': %s\n", findParserLine(parser, token), token.length < PARSER_ERROR_LEXEME ? token.length : PARSER_ERROR_LEXEME, token.lexeme, message);
+		}
+
+		parser->errorOutput(buffer);
+		return;
+	}
+
+	fprintf(stderr, "[Line %d] Error", findParserLine(parser, token));
 
 	//check type
 	if (token.type == TOKEN_EOF) {
@@ -26,13 +50,11 @@ static void error(Parser* parser, Token token, const char* message) {
 
 	//finally
 	fprintf(stderr, ": %s\n", message);
-	parser->error = true;
-	parser->panic = true;
 }
 
 static void advance(Parser* parser) {
 	parser->previous = parser->current;
-	parser->current = scanLexer(parser->lexer);
+	parser->current = parser->tokens != NULL ? readTokenBuffer(parser->tokens, parser->next++) : scanLexer(parser->lexer);
 
 	if (parser->current.type == TOKEN_ERROR) {
 		error(parser, parser->current, "Lexer error");
@@ -99,7 +121,8 @@ typedef enum {
 	PREC_PRIMARY,
 } PrecedenceRule;
 
-typedef Opcode (*ParseFn)(Parser* parser, Node** nodeHandle, bool canBeAssigned);
+//a rule that needs an operand pushes a frame, and returns the precedence to parse the operand at, otherwise PREC_NONE
+typedef PrecedenceRule (*ParseFn)(Parser* parser, NodeArray* nodes, bool canBeAssigned);
 
 typedef struct {
 	ParseFn prefix;
@@ -108,164 +131,253 @@ typedef struct {
 } ParseRule;
 
 ParseRule parseRules[];
+ParseRule* getRule(TokenType type);
+
+//the rules waiting on an operand are kept on the parser's own stack instead of the C stack, so nesting is only limited by memory
+typedef enum ParseFrameType {
+	FRAME_GROUPING, //waiting on the inside of a grouping
+	FRAME_UNARY, //waiting on the operand of a unary operator
+	FRAME_BINARY, //waiting on the right hand side of a binary operator
+} ParseFrameType;
+
+typedef struct ParseFrame {
+	unsigned char type;
+	unsigned char opcode; //unary: OP_EOF once the operand was negated as it was read, binary: the operator
+	unsigned char rule; //the precedence of the expression this frame belongs to
+	NodeIndex start; //where the expression this frame belongs to starts
+	NodeIndex mark; //grouping: the begin node, unary: the operand, binary: the left hand side
+} ParseFrame;
+
+//the steps of the loops that parse an expression
+typedef enum ParseStep {
+	STEP_PREFIX, //an operand is next
+	STEP_INFIX, //the operand is done, so look for operators
+	STEP_RETURN, //the expression is done, so resume the frame waiting on it
+} ParseStep;
+
+//the rule fills in the type, and the loop fills in the rest once it knows the rule was waiting
+static void pushFrame(Parser* parser, ParseFrameType type, Opcode opcode, NodeIndex mark) {
+	if (parser->frameCapacity < parser->frameCount + 1) {
+		int oldCapacity = parser->frameCapacity;
+
+		parser->frameCapacity = GROW_CAPACITY(oldCapacity);
+		parser->frames = GROW_ARRAY(ParseFrame, parser->frames, oldCapacity, parser->frameCapacity);
+	}
+
+	parser->frames[parser->frameCount++] = (ParseFrame){ type, opcode, PREC_NONE, 0, mark };
+}
+
+static void holdFrame(Parser* parser, PrecedenceRule rule, NodeIndex start) {
+	parser->frames[parser->frameCount - 1].rule = rule;
+	parser->frames[parser->frameCount - 1].start = start;
+}
+
+//the lexeme is read in place, no copy or terminator needed
+static int readInteger(Parser* parser) {
+	int value = 0;
+
+	if (spanToInteger(parser->previous.lexeme, parser->previous.length, &value)) {
+		return value;
+	}
+
+	//one more than INT_MAX only fits once it's negated, so it's allowed right after a unary minus, which is folded into it
+	//the minus takes everything down to PREC_TERNARY, so the literal has to be followed by something weaker to be all it applies to
+	ParseFrame* frame = parser->frameCount > 0 ? &parser->frames[parser->frameCount - 1] : NULL;
+
+	if (frame != NULL && frame->type == FRAME_UNARY && frame->opcode == OP_NEGATE && getRule(parser->current.type)->precedence < PREC_TERNARY && spanToNegativeInteger(parser->previous.lexeme, parser->previous.length, &value)) {
+		frame->opcode = OP_EOF; //already negated
+		return value;
+	}
 
-//forward declarations
-static void parsePrecedence(Parser* parser, Node** nodeHandle, PrecedenceRule rule);
+	error(parser, parser->previous, "Integer literal out of range");
+	return 0;
+}
+
+static float readFloat(Parser* parser) {
+	return spanToFloat(parser->previous.lexeme, parser->previous.length);
+}
 
-//the expression rules
-static Opcode string(Parser* parser, Node** nodeHandle, bool canBeAssigned) {
+//the expression rules push their nodes onto the end of the array
+static PrecedenceRule string(Parser* parser, NodeArray* nodes, bool canBeAssigned) {
 	//handle strings
 	switch(parser->previous.type) {
 		case TOKEN_LITERAL_STRING:
-			emitNodeLiteral(nodeHandle, TO_STRING_LITERAL(copyString(parser->previous.lexeme, parser->previous.length)));
-			return OP_EOF;
+			pushNodeLiteral(nodes, TO_STRING_LITERAL(copyString(parser->previous.lexeme, parser->previous.length)));
+			return PREC_NONE;
 
 		//TODO: interpolated strings
 
 		default:
 			error(parser, parser->previous, "Unexpected token passed to string precedence rule");
-			return OP_EOF;
+			return PREC_NONE;
 	}
 }
 
-static Opcode grouping(Parser* parser, Node** nodeHandle, bool canBeAssigned) {
-	//handle three diffent types of groupings: (), {}, []
-	switch(parser->previous.type) {
-		case TOKEN_PAREN_LEFT: {
-			Node* tmpNode = NULL;
-			parsePrecedence(parser, &tmpNode, PREC_TERNARY);
-			consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of grouping");
-
-			//if it's just a literal, don't need a grouping
-			if (command.optimize >= 1 && tmpNode->type == NODE_LITERAL) {
-				(*nodeHandle) = tmpNode;
-				return OP_EOF;
-			}
+//the operators both front ends share, each returns the precedence its operand is parsed at, or PREC_NONE if the token isn't one
+static PrecedenceRule prefixOperator(TokenType type, ParseFrameType* frame, Opcode* opcode) {
+	switch(type) {
+		case TOKEN_PAREN_LEFT:
+			*frame = FRAME_GROUPING;
+			*opcode = OP_EOF;
+			return PREC_TERNARY;
 
-			//process the result without optimisations
-			emitNodeGrouping(nodeHandle);
-			nodeHandle = &((*nodeHandle)->unary.child); //re-align after append
-			(*nodeHandle) = tmpNode;
-			return OP_EOF;
-		}
+		case TOKEN_MINUS:
+			*frame = FRAME_UNARY;
+			*opcode = OP_NEGATE;
+			return PREC_TERNARY; //can be a literal
 
 		default:
-			error(parser, parser->previous, "Unexpected token passed to grouping precedence rule");
-			return OP_EOF;
+			return PREC_NONE;
 	}
 }
 
-static Opcode binary(Parser* parser, Node** nodeHandle, bool canBeAssigned) {
-	advance(parser);
-
-	//binary() is an infix rule - so only get the RHS of the operator
-	switch(parser->previous.type) {
-		case TOKEN_PLUS: {
-			parsePrecedence(parser, nodeHandle, PREC_TERM);
-			return OP_ADDITION;
-		}
+static PrecedenceRule binaryOperator(TokenType type, Opcode* opcode) {
+	switch(type) {
+		case TOKEN_PLUS:
+			*opcode = OP_ADDITION;
+			return PREC_TERM;
 
-		case TOKEN_MINUS: {
-			parsePrecedence(parser, nodeHandle, PREC_TERM);
-			return OP_SUBTRACTION;
-		}
+		case TOKEN_MINUS:
+			*opcode = OP_SUBTRACTION;
+			return PREC_TERM;
 
-		case TOKEN_MULTIPLY: {
-			parsePrecedence(parser, nodeHandle, PREC_FACTOR);
-			return OP_MULTIPLICATION;
-		}
+		case TOKEN_MULTIPLY:
+			*opcode = OP_MULTIPLICATION;
+			return PREC_FACTOR;
 
-		case TOKEN_DIVIDE: {
-			parsePrecedence(parser, nodeHandle, PREC_FACTOR);
-			return OP_DIVISION;
-		}
+		case TOKEN_DIVIDE:
+			*opcode = OP_DIVISION;
+			return PREC_FACTOR;
 
-		case TOKEN_MODULO: {
-			parsePrecedence(parser, nodeHandle, PREC_FACTOR);
-			return OP_MODULO;
-		}
+		case TOKEN_MODULO:
+			*opcode = OP_MODULO;
+			return PREC_FACTOR;
 
 		default:
-			error(parser, parser->previous, "Unexpected token passed to binary precedence rule");
-			return OP_EOF;
+			return PREC_NONE;
 	}
 }
 
-static Opcode unary(Parser* parser, Node** nodeHandle, bool canBeAssigned) {
-	switch(parser->previous.type) {
-		case TOKEN_MINUS: {
-			//temp handle to potentially negate values
-			Node* tmpNode = NULL;
-			parsePrecedence(parser, &tmpNode, PREC_TERNARY); //can be a literal
-
-			//check for negative literals (optimisation)
-			if (command.optimize >= 1 && tmpNode->type == NODE_LITERAL) {
-				//negate directly, if int or float
-				Literal lit = tmpNode->atomic.literal;
-
-				if (IS_INTEGER(lit)) {
-					lit = TO_INTEGER_LITERAL(-AS_INTEGER(lit));
-				}
+static PrecedenceRule grouping(Parser* parser, NodeArray* nodes, bool canBeAssigned) {
+	//handle three diffent types of groupings: (), {}, []
+	ParseFrameType frame;
+	Opcode opcode;
+	PrecedenceRule operand = prefixOperator(parser->previous.type, &frame, &opcode);
 
-				if (IS_FLOAT(lit)) {
-					lit = TO_FLOAT_LITERAL(-AS_FLOAT(lit));
-				}
+	if (operand == PREC_NONE || frame != FRAME_GROUPING) {
+		error(parser, parser->previous, "Unexpected token passed to grouping precedence rule");
+		return PREC_NONE;
+	}
 
-				tmpNode->atomic.literal = lit;
-				*nodeHandle = tmpNode;
+	pushFrame(parser, frame, opcode, pushNodeGroupingBegin(nodes));
+	return operand;
+}
 
-				return OP_EOF;
-			}
+static void finishGrouping(Parser* parser, NodeArray* nodes, NodeIndex begin) {
+	consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of grouping");
 
-			//process the literal without optimizations
-			if (tmpNode->type == NODE_LITERAL) {
-				emitNodeUnary(nodeHandle, OP_NEGATE);
-				nodeHandle = &((*nodeHandle)->unary.child); //re-align after append
-				(*nodeHandle) = tmpNode; //set negate's child to the literal
-				return OP_EOF;
-			}
+	//if it's just a literal, don't need a grouping
+	if (parser->optimize >= 1 && nodes->count == begin + 2 && nodes->nodes[begin + 1].type == NODE_LITERAL) {
+		nodes->nodes[begin] = nodes->nodes[begin + 1];
+		nodes->count--;
+		return;
+	}
+
+	//process the result without optimisations
+	pushNodeGrouping(nodes);
+}
+
+static PrecedenceRule binary(Parser* parser, NodeArray* nodes, bool canBeAssigned) {
+	NodeIndex left = nodes->count - 1;
+	advance(parser);
+
+	//binary() is an infix rule - so only get the RHS of the operator
+	Opcode opcode;
+	PrecedenceRule operand = binaryOperator(parser->previous.type, &opcode);
+
+	if (operand == PREC_NONE) {
+		error(parser, parser->previous, "Unexpected token passed to binary precedence rule");
+		return PREC_NONE;
+	}
+
+	pushFrame(parser, FRAME_BINARY, opcode, left);
+	return operand;
+}
+
+static PrecedenceRule unary(Parser* parser, NodeArray* nodes, bool canBeAssigned) {
+	ParseFrameType frame;
+	Opcode opcode;
+	PrecedenceRule operand = prefixOperator(parser->previous.type, &frame, &opcode);
+
+	if (operand == PREC_NONE || frame != FRAME_UNARY) {
+		error(parser, parser->previous, "Unexpected token passed to unary precedence rule");
+		return PREC_NONE;
+	}
+
+	pushFrame(parser, frame, opcode, nodes->count);
+	return operand;
+}
+
+static void finishUnary(Parser* parser, NodeArray* nodes, NodeIndex child, Opcode opcode) {
+	if (nodes->count != child + 1 || nodes->nodes[child].type != NODE_LITERAL) {
+		error(parser, parser->previous, "Unexpected token passed to unary minus precedence rule");
+		return;
+	}
+
+	//readInteger() already negated it
+	if (opcode == OP_EOF) {
+		return;
+	}
 
-			error(parser, parser->previous, "Unexpected token passed to unary minus precedence rule");
-			return OP_EOF;
+	//check for negative literals (optimisation)
+	if (parser->optimize >= 1) {
+		//negate directly, if int or float
+		Literal* lit = &nodes->literals[nodes->nodes[child].operand];
+
+		if (IS_INTEGER(*lit)) {
+			*lit = TO_INTEGER_LITERAL(-AS_INTEGER(*lit));
 		}
 
-		default:
-			error(parser, parser->previous, "Unexpected token passed to unary precedence rule");
-			return OP_EOF;
+		if (IS_FLOAT(*lit)) {
+			*lit = TO_FLOAT_LITERAL(-AS_FLOAT(*lit));
+		}
+
+		return;
 	}
+
+	//process the literal without optimizations
+	pushNodeUnary(nodes, OP_NEGATE);
 }
 
-static Opcode atomic(Parser* parser, Node** nodeHandle, bool canBeAssigned) {
+static PrecedenceRule atomic(Parser* parser, NodeArray* nodes, bool canBeAssigned) {
 	switch(parser->previous.type) {
 		case TOKEN_NULL:
-			emitNodeLiteral(nodeHandle, TO_NULL_LITERAL);
-			return OP_EOF;
+			pushNodeLiteral(nodes, TO_NULL_LITERAL);
+			return PREC_NONE;
 
 		case TOKEN_LITERAL_TRUE:
-			emitNodeLiteral(nodeHandle, TO_BOOLEAN_LITERAL(true));
-			return OP_EOF;
+			pushNodeLiteral(nodes, TO_BOOLEAN_LITERAL(true));
+			return PREC_NONE;
 
 		case TOKEN_LITERAL_FALSE:
-			emitNodeLiteral(nodeHandle, TO_BOOLEAN_LITERAL(false));
-			return OP_EOF;
+			pushNodeLiteral(nodes, TO_BOOLEAN_LITERAL(false));
+			return PREC_NONE;
 
 		case TOKEN_LITERAL_INTEGER: {
-			int value = 0;
-			sscanf(parser->previous.lexeme, "%d", &value);
-			emitNodeLiteral(nodeHandle, TO_INTEGER_LITERAL(value));
-			return OP_EOF;
+			int value = readInteger(parser);
+			pushNodeLiteral(nodes, TO_INTEGER_LITERAL(value));
+			return PREC_NONE;
 		}
 
 		case TOKEN_LITERAL_FLOAT: {
-			float value = 0;
-			sscanf(parser->previous.lexeme, "%f", &value);
-			emitNodeLiteral(nodeHandle, TO_FLOAT_LITERAL(value));
-			return OP_EOF;
+			float value = readFloat(parser);
+			pushNodeLiteral(nodes, TO_FLOAT_LITERAL(value));
+			return PREC_NONE;
 		}
 
 		default:
 			error(parser, parser->previous, "Unexpected token passed to atomic precedence rule");
-			return OP_EOF;
+			return PREC_NONE;
 	}
 }
 
@@ -361,8 +473,11 @@ ParseRule* getRule(TokenType type) {
 	return &parseRules[type];
 }
 
-static bool calcStaticBinaryArithmetic(Node** nodeHandle) {
-	switch((*nodeHandle)->binary.opcode) {
+//folds the binary node at the end of the array, whose subtree starts at index
+static bool calcStaticBinaryArithmetic(NodeArray* nodes, NodeIndex index) {
+	Node* node = &nodes->nodes[nodes->count - 1];
+
+	switch(node->opcode) {
 		case OP_ADDITION:
 		case OP_SUBTRACTION:
 		case OP_MULTIPLICATION:
@@ -374,23 +489,15 @@ static bool calcStaticBinaryArithmetic(Node** nodeHandle) {
 			return true;
 	}
 
-	//recurse to the left and right
-	if ((*nodeHandle)->binary.left->type == NODE_BINARY) {
-		calcStaticBinaryArithmetic(&(*nodeHandle)->binary.left);
-	}
-
-	if ((*nodeHandle)->binary.right->type == NODE_BINARY) {
-		calcStaticBinaryArithmetic(&(*nodeHandle)->binary.right);
-	}
-
-	//make sure left and right are both literals
-	if (!((*nodeHandle)->binary.left->type == NODE_LITERAL && (*nodeHandle)->binary.right->type == NODE_LITERAL)) {
+	//the children were folded as they were parsed, so only a literal on each side is left to check for
+	//a parse error can leave a side empty, and then there is nothing to fold
+	if (nodes->count != index + 3 || node->operand != index || nodes->nodes[index].type != NODE_LITERAL || nodes->nodes[index + 1].type != NODE_LITERAL) {
 		return true;
 	}
 
 	//evaluate
-	Literal lhs = (*nodeHandle)->binary.left->atomic.literal;
-	Literal rhs = (*nodeHandle)->binary.right->atomic.literal;
+	Literal lhs = nodes->literals[nodes->nodes[index].operand];
+	Literal rhs = nodes->literals[nodes->nodes[index + 1].operand];
 	Literal result = TO_NULL_LITERAL;
 
 	//type coersion
@@ -404,7 +511,7 @@ static bool calcStaticBinaryArithmetic(Node** nodeHandle) {
 
 	//maths based on types
 	if(IS_INTEGER(lhs) && IS_INTEGER(rhs)) {
-		switch((*nodeHandle)->binary.opcode) {
+		switch(node->opcode) {
 			case OP_ADDITION:
 				result = TO_INTEGER_LITERAL( AS_INTEGER(lhs) + AS_INTEGER(rhs) );
 			break;
@@ -428,13 +535,13 @@ static bool calcStaticBinaryArithmetic(Node** nodeHandle) {
 	}
 
 	//catch bad modulo
-	if ((IS_FLOAT(lhs) || IS_FLOAT(rhs)) && (*nodeHandle)->binary.opcode == OP_MODULO) {
+	if ((IS_FLOAT(lhs) || IS_FLOAT(rhs)) && node->opcode == OP_MODULO) {
 		printf("Bad arithmetic argument (modulo on floats not allowed)");
 		return false;
 	}
 
 	if(IS_FLOAT(lhs) && IS_FLOAT(rhs)) {
-		switch((*nodeHandle)->binary.opcode) {
+		switch(node->opcode) {
 			case OP_ADDITION:
 				result = TO_FLOAT_LITERAL( AS_FLOAT(lhs) + AS_FLOAT(rhs) );
 			break;
@@ -458,129 +565,398 @@ static bool calcStaticBinaryArithmetic(Node** nodeHandle) {
 		return true;
 	}
 
-	//optimize by converting this node into a literal
-	freeNode((*nodeHandle)->binary.left);
-	freeNode((*nodeHandle)->binary.right);
-
-	(*nodeHandle)->type = NODE_LITERAL;
-	(*nodeHandle)->atomic.literal = result;
+	//optimize by converting this subtree into a literal
+	foldNodeArray(nodes, index, result);
 
 	return true;
 }
 
-static void parsePrecedence(Parser* parser, Node** nodeHandle, PrecedenceRule rule) {
-	//every expression has a prefix rule
-	advance(parser);
-	ParseFn prefixRule = getRule(parser->previous.type)->prefix;
+static void parsePrecedence(Parser* parser, NodeArray* nodes, PrecedenceRule rule) {
+	//frames below this belong to someone else
+	const int base = parser->frameCount;
+	ParseStep step = STEP_PREFIX;
 
-	if (prefixRule == NULL) {
-		*nodeHandle = NULL; //the handle's value MUST be set to null for error handling
-		error(parser, parser->previous, "Expected expression");
-		return;
-	}
+	//the subtree for this expression starts at the end of the array
+	NodeIndex start = nodes->count;
 
-	bool canBeAssigned = rule <= PREC_ASSIGNMENT;
-	prefixRule(parser, nodeHandle, canBeAssigned); //ignore the returned opcode
+	for (;;) {
+		switch(step) {
+			case STEP_PREFIX: {
+				start = nodes->count;
 
-	//infix rules are left-recursive
-	while (rule <= getRule(parser->current.type)->precedence) {
-		ParseFn infixRule = getRule(parser->current.type)->infix;
+				//every expression has a prefix rule
+				advance(parser);
+				ParseFn prefixRule = getRule(parser->previous.type)->prefix;
 
-		if (infixRule == NULL) {
-			*nodeHandle = NULL; //the handle's value MUST be set to null for error handling
-			error(parser, parser->current, "Expected operator");
-			return;
-		}
+				if (prefixRule == NULL) {
+					error(parser, parser->previous, "Expected expression");
+					step = STEP_RETURN;
+					break;
+				}
 
-		Node* rhsNode = NULL;
-		const Opcode opcode = infixRule(parser, &rhsNode, canBeAssigned); //NOTE: infix rule must advance the parser
-		emitNodeBinary(nodeHandle, rhsNode, opcode);
+				PrecedenceRule operand = prefixRule(parser, nodes, rule <= PREC_ASSIGNMENT);
 
-		if (command.optimize >= 1 && !calcStaticBinaryArithmetic(nodeHandle)) {
-			return;
-		}
-	}
+				if (operand != PREC_NONE) {
+					holdFrame(parser, rule, start);
+					rule = operand;
+					break;
+				}
+
+				step = STEP_INFIX;
+				break;
+			}
+
+			case STEP_INFIX: {
+				//infix rules are left-recursive
+				if (rule <= getRule(parser->current.type)->precedence) {
+					ParseFn infixRule = getRule(parser->current.type)->infix;
+
+					if (infixRule == NULL) {
+						error(parser, parser->current, "Expected operator");
+						step = STEP_RETURN;
+						break;
+					}
+
+					PrecedenceRule operand = infixRule(parser, nodes, rule <= PREC_ASSIGNMENT); //NOTE: infix rule must advance the parser
+
+					if (operand == PREC_NONE) {
+						step = STEP_RETURN;
+						break;
+					}
+
+					holdFrame(parser, rule, start);
+					rule = operand;
+					step = STEP_PREFIX;
+					break;
+				}
+
+				//if your precedence is below "assignment"
+				if (rule <= PREC_ASSIGNMENT && match(parser, TOKEN_ASSIGN)) {
+					error(parser, parser->current, "Invalid assignment target");
+				}
+
+				step = STEP_RETURN;
+				break;
+			}
+
+			case STEP_RETURN: {
+				if (parser->frameCount == base) {
+					return;
+				}
+
+				//carry on with the expression that was waiting on this one
+				ParseFrame frame = parser->frames[--parser->frameCount];
+				rule = frame.rule;
+				start = frame.start;
+				step = STEP_INFIX;
+
+				switch(frame.type) {
+					case FRAME_GROUPING:
+						finishGrouping(parser, nodes, frame.mark);
+						break;
+
+					case FRAME_UNARY:
+						finishUnary(parser, nodes, frame.mark, frame.opcode);
+						break;
 
-	//if your precedence is below "assignment"
-	if (canBeAssigned && match(parser, TOKEN_ASSIGN)) {
-		error(parser, parser->current, "Invalid assignment target");
+					case FRAME_BINARY:
+						pushNodeBinary(nodes, frame.mark, frame.opcode);
+
+						if (parser->optimize >= 1 && !calcStaticBinaryArithmetic(nodes, start)) {
+							step = STEP_RETURN;
+						}
+						break;
+				}
+				break;
+			}
+		}
 	}
 }
 
 //expressions
-static void expression(Parser* parser, Node** nodeHandle) {
+static void expression(Parser* parser, NodeArray* nodes) {
 	//delegate to the pratt table for expression precedence
-	parsePrecedence(parser, nodeHandle, PREC_ASSIGNMENT);
+	parsePrecedence(parser, nodes, PREC_ASSIGNMENT);
 }
 
 //statements
-static void printStmt(Parser* parser, Node* node) {
-	//set the node info
-	node->type = NODE_UNARY;
-	node->unary.opcode = OP_PRINT;
-	expression(parser, &(node->unary.child));
-
+static void printStmt(Parser* parser, NodeArray* nodes) {
+	expression(parser, nodes);
 	consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of print statement");
-}
 
-static void assertStmt(Parser* parser, Node* node) {
-	//set the node info
-	node->type = NODE_BINARY;
-	node->unary.opcode = OP_ASSERT;
+	pushNodeUnary(nodes, OP_PRINT);
+}
 
-	expression(parser, &(node->binary.left));
+static void assertStmt(Parser* parser, NodeArray* nodes) {
+	expression(parser, nodes);
 	consume(parser, TOKEN_COMMA, "Expected ',' in assert statement");
-	expression(parser, &(node->binary.right));
 
+	NodeIndex left = nodes->count - 1;
+	expression(parser, nodes);
 	consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of assert statement");
+
+	pushNodeBinary(nodes, left, OP_ASSERT);
 }
 
 //precedence functions
-static void expressionStmt(Parser* parser, Node* node) {
-	error(parser, parser->previous, "Expression statements not yet implemented");
+static void expressionStmt(Parser* parser, NodeArray* nodes) {
+	error(parser, parser->current, "Expression statements not yet implemented");
 }
 
-static void statement(Parser* parser, Node* node) {
+static void statement(Parser* parser, NodeArray* nodes) {
 	//print
 	if (match(parser, TOKEN_PRINT)) {
-		printStmt(parser, node);
+		printStmt(parser, nodes);
 		return;
 	}
 
 	//assert
 	if (match(parser, TOKEN_ASSERT)) {
-		assertStmt(parser, node);
+		assertStmt(parser, nodes);
 		return;
 	}
 
 	//default
-	expressionStmt(parser, node);
+	expressionStmt(parser, nodes);
 }
 
-static void declaration(Parser* parser, Node** nodeHandle) {
-	statement(parser, *nodeHandle);
+//the direct front end mirrors the rules above, but writes bytecode as it goes instead of building nodes
+//the pratt table still decides what's valid, so both front ends accept exactly the same source
+static void writeLiteral(Parser* parser, Compiler* compiler) {
+	switch(parser->previous.type) {
+		case TOKEN_NULL:
+			writeCompilerLiteral(compiler, TO_NULL_LITERAL);
+			return;
 
-	if (parser->panic) {
-		synchronize(parser);
-		//return an error node for this iteration
-		*nodeHandle = ALLOCATE(Node, 1);
-		(*nodeHandle)->type = NODE_ERROR;
+		case TOKEN_LITERAL_TRUE:
+			writeCompilerLiteral(compiler, TO_BOOLEAN_LITERAL(true));
+			return;
+
+		case TOKEN_LITERAL_FALSE:
+			writeCompilerLiteral(compiler, TO_BOOLEAN_LITERAL(false));
+			return;
+
+		case TOKEN_LITERAL_INTEGER: {
+			int value = readInteger(parser);
+			writeCompilerLiteral(compiler, TO_INTEGER_LITERAL(value));
+			return;
+		}
+
+		case TOKEN_LITERAL_FLOAT: {
+			float value = readFloat(parser);
+			writeCompilerLiteral(compiler, TO_FLOAT_LITERAL(value));
+			return;
+		}
+
+		case TOKEN_LITERAL_STRING: {
+			//the cache keeps its own copy
+			Literal literal = TO_STRING_LITERAL(copyString(parser->previous.lexeme, parser->previous.length));
+			writeCompilerLiteral(compiler, literal);
+			freeLiteral(literal);
+			return;
+		}
+
+		default:
+			error(parser, parser->previous, "Unexpected token passed to atomic precedence rule");
+			return;
 	}
 }
 
-//exposed functions
-void initParser(Parser* parser, Lexer* lexer) {
-	parser->lexer = lexer;
+//returns true if the expression was a lone literal, which is all unary minus accepts without optimizations
+static bool writePrecedence(Parser* parser, Compiler* compiler, PrecedenceRule rule) {
+	//frames below this belong to someone else
+	const int base = parser->frameCount;
+	ParseStep step = STEP_PREFIX;
+	bool literal = false;
+
+	for (;;) {
+		switch(step) {
+			case STEP_PREFIX: {
+				//every expression has a prefix rule
+				advance(parser);
+				literal = false;
+				step = STEP_INFIX;
+
+				if (getRule(parser->previous.type)->prefix == NULL) {
+					error(parser, parser->previous, "Expected expression");
+					step = STEP_RETURN;
+					break;
+				}
+
+				//anything that isn't an operator stands alone
+				ParseFrameType frame;
+				Opcode opcode;
+				PrecedenceRule operand = prefixOperator(parser->previous.type, &frame, &opcode);
+
+				if (operand == PREC_NONE) {
+					writeLiteral(parser, compiler);
+					literal = true;
+					break;
+				}
+
+				if (frame == FRAME_GROUPING) {
+					writeCompilerOpcode(compiler, OP_GROUPING_BEGIN);
+				}
+
+				pushFrame(parser, frame, opcode, 0);
+				holdFrame(parser, rule, 0);
+				rule = operand;
+				step = STEP_PREFIX;
+				break;
+			}
+
+			case STEP_INFIX: {
+				//infix rules are left-recursive
+				if (rule <= getRule(parser->current.type)->precedence) {
+					if (getRule(parser->current.type)->infix == NULL) {
+						error(parser, parser->current, "Expected operator");
+						literal = false;
+						step = STEP_RETURN;
+						break;
+					}
+
+					advance(parser);
+
+					//the same operators as binary()
+					Opcode opcode;
+					PrecedenceRule operand = binaryOperator(parser->previous.type, &opcode);
+
+					if (operand == PREC_NONE) {
+						error(parser, parser->previous, "Unexpected token passed to binary precedence rule");
+						literal = false;
+						step = STEP_RETURN;
+						break;
+					}
+
+					pushFrame(parser, FRAME_BINARY, opcode, 0);
+					holdFrame(parser, rule, 0);
+					rule = operand;
+					step = STEP_PREFIX;
+					break;
+				}
+
+				//if your precedence is below "assignment"
+				if (rule <= PREC_ASSIGNMENT && match(parser, TOKEN_ASSIGN)) {
+					error(parser, parser->current, "Invalid assignment target");
+				}
+
+				step = STEP_RETURN;
+				break;
+			}
+
+			case STEP_RETURN: {
+				if (parser->frameCount == base) {
+					return literal;
+				}
+
+				//carry on with the expression that was waiting on this one, literal is still the operand's
+				ParseFrame frame = parser->frames[--parser->frameCount];
+				rule = frame.rule;
+				step = STEP_INFIX;
+
+				switch(frame.type) {
+					case FRAME_GROUPING:
+						consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of grouping");
+						writeCompilerOpcode(compiler, OP_GROUPING_END);
+						break;
+
+					case FRAME_UNARY:
+						if (!literal) {
+							error(parser, parser->previous, "Unexpected token passed to unary minus precedence rule");
+							step = STEP_RETURN;
+							break;
+						}
+
+						//readInteger() may have negated it already
+						if (frame.opcode != OP_EOF) {
+							writeCompilerOpcode(compiler, frame.opcode);
+						}
+						break;
+
+					case FRAME_BINARY:
+						writeCompilerOpcode(compiler, frame.opcode);
+						break;
+				}
+
+				literal = false;
+				break;
+			}
+		}
+	}
+}
+
+static void writeStatement(Parser* parser, Compiler* compiler) {
+	//print
+	if (match(parser, TOKEN_PRINT)) {
+		writePrecedence(parser, compiler, PREC_ASSIGNMENT);
+		consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of print statement");
+		writeCompilerOpcode(compiler, OP_PRINT);
+		return;
+	}
+
+	//assert
+	if (match(parser, TOKEN_ASSERT)) {
+		writePrecedence(parser, compiler, PREC_ASSIGNMENT);
+		consume(parser, TOKEN_COMMA, "Expected ',' in assert statement");
+		writePrecedence(parser, compiler, PREC_ASSIGNMENT);
+		consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of assert statement");
+		writeCompilerOpcode(compiler, OP_ASSERT);
+		return;
+	}
+
+	//default
+	error(parser, parser->current, "Expression statements not yet implemented");
+}
+
+static void resetParser(Parser* parser) {
+	parser->next = 0;
 	parser->error = false;
 	parser->panic = false;
 
 	parser->previous.type = TOKEN_NULL;
 	parser->current.type = TOKEN_NULL;
+	parser->statement.type = TOKEN_NULL;
+	parser->statement.line = 0;
+	parser->optimize = 1;
+	parser->quiet = false;
+	parser->errorOutput = NULL;
+	parser->frames = NULL;
+	parser->frameCapacity = 0;
+	parser->frameCount = 0;
+}
+
+//exposed functions
+void initParser(Parser* parser, Lexer* lexer) {
+	resetParser(parser);
+	parser->lexer = lexer;
+	parser->tokens = NULL;
+	advance(parser);
+}
+
+void initParserOutput(Parser* parser, Lexer* lexer, PrintFn errorOutput) {
+	resetParser(parser);
+	parser->lexer = lexer;
+	parser->tokens = NULL;
+	parser->errorOutput = errorOutput;
+	advance(parser);
+}
+
+void initParserTokens(Parser* parser, TokenBuffer* tokens) {
+	resetParser(parser);
+	parser->lexer = NULL;
+	parser->tokens = tokens;
 	advance(parser);
 }
 
 void freeParser(Parser* parser) {
+	FREE_ARRAY(ParseFrame, parser->frames, parser->frameCapacity);
+	parser->frames = NULL;
+	parser->frameCapacity = 0;
+	parser->frameCount = 0;
+
 	parser->lexer = NULL;
+	parser->tokens = NULL;
+	parser->next = 0;
 	parser->error = false;
 	parser->panic = false;
 
@@ -588,18 +964,46 @@ void freeParser(Parser* parser) {
 	parser->current.type = TOKEN_NULL;
 }
 
-Node* scanParser(Parser* parser) {
+int findParserLine(Parser* parser, Token token) {
+	return parser->tokens != NULL ? findTokenBufferLine(parser->tokens, &token) : token.line;
+}
+
+bool scanParser(Parser* parser, NodeArray* nodes) {
+	//check for EOF
+	if (match(parser, TOKEN_EOF)) {
+		return false;
+	}
+
+	parser->statement = parser->current;
+
+	//process the grammar rule for this line
+	TRACE_BEGIN_VALUE("parser", "statement", "line", findParserLine(parser, parser->statement));
+	statement(parser, nodes);
+	TRACE_END("parser", "statement");
+
+	if (parser->panic) {
+		synchronize(parser);
+	}
+
+	return true;
+}
+
+bool writeParser(Parser* parser, Compiler* compiler) {
 	//check for EOF
 	if (match(parser, TOKEN_EOF)) {
-		return NULL;
+		return false;
 	}
 
-	//returns nodes on the heap
-	Node* node = ALLOCATE(Node, 1);
-	node->type = NODE_ERROR; //BUGFIX: so freeing won't break the damn thing
+	parser->statement = parser->current;
 
 	//process the grammar rule for this line
-	declaration(parser, &node);
+	TRACE_BEGIN_VALUE("parser", "statement", "line", findParserLine(parser, parser->statement));
+	writeStatement(parser, compiler);
+	TRACE_END("parser", "statement");
 
-	return node;
+	if (parser->panic) {
+		synchronize(parser);
+	}
+
+	return true;
 }
@@ -3,19 +3,46 @@
 #include "parser.h"
 
 #include "lexer.h"
+#include "token_buffer.h"
 #include "node.h"
+#include "compiler.h"
 
 //DOCS: parsers are bound to a lexer, and turn the outputted tokens into AST nodes
 typedef struct {
 	Lexer* lexer;
+	TokenBuffer* tokens; //read instead of the lexer when not NULL
+	int next; //the index of the next token to read from the buffer
 	bool error; //I've had an error
 	bool panic; //I am processing an error
 
 	//track the last two outputs from the lexer
 	Token current;
 	Token previous;
+
+	Token statement; //the first token of the last statement scanned, its line is found with findParserLine()
+	int optimize; //fold constant expressions at 1 and above, defaults to 1
+	bool quiet; //set the error flag without reporting anything, for parses that may be thrown away
+	PrintFn errorOutput; //receives each error report instead of stderr, when not NULL
+
+	//the expressions waiting on an operand, so nesting is only limited by memory rather than the C stack
+	struct ParseFrame* frames;
+	int frameCapacity;
+	int frameCount;
 } Parser;
 
 void initParser(Parser* parser, Lexer* lexer);
+void initParserTokens(Parser* parser, TokenBuffer* tokens); //for a source that's already been lexed
+void initParserOutput(Parser* parser, Lexer* lexer, PrintFn errorOutput); //set before the first token is scanned, so its error is reported there too
 void freeParser(Parser* parser);
-Node* scanParser(Parser* parser);
+
+//a token from a buffer has its line looked up only when it's asked for, which is here
+int findParserLine(Parser* parser, Token token);
+
+//parse one statement onto the end of the array, returns false at the end of the source
+//once parser->error is set the array is incomplete, and should be thrown away
+bool scanParser(Parser* parser, NodeArray* nodes);
+
+//parse one statement straight into the compiler, for when no optimizations are wanted, and so no nodes are needed
+//the bytecode matches what scanParser() and writeCompiler() produce at -O0, returns false at the end of the source
+//once parser->error is set the compiler's code is incomplete, and should be thrown away
+bool writeParser(Parser* parser, Compiler* compiler);
@@ -0,0 +1,218 @@
+#include "profiler.h"
+
+#include "debug.h"
+#include "memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PAIR_REPORT_LIMIT 10
+
+typedef struct {
+	int first;
+	int second;
+	unsigned long long count;
+	unsigned long long nanoseconds;
+} ProfileEntry;
+
+static unsigned long long readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char* opcodeName(int opcode) {
+	const char* name = findOpcodeName((Opcode)opcode);
+	return name != NULL ? name : "unknown";
+}
+
+//heaviest first
+static int compareTime(const void* lhs, const void* rhs) {
+	const ProfileEntry* a = lhs;
+	const ProfileEntry* b = rhs;
+
+	if (a->nanoseconds != b->nanoseconds) {
+		return a->nanoseconds < b->nanoseconds ? 1 : -1;
+	}
+
+	return a->first - b->first;
+}
+
+static int compareCount(const void* lhs, const void* rhs) {
+	const ProfileEntry* a = lhs;
+	const ProfileEntry* b = rhs;
+
+	if (a->count != b->count) {
+		return a->count < b->count ? 1 : -1;
+	}
+
+	return a->first != b->first ? a->first - b->first : a->second - b->second;
+}
+
+//gather the non-zero entries, sorted for reporting
+static int collectOpcodes(Profiler* profiler, ProfileEntry* entries) {
+	int count = 0;
+
+	for (int i = 0; i < 256; i++) {
+		if (profiler->counts[i] == 0) {
+			continue;
+		}
+
+		entries[count].first = i;
+		entries[count].second = -1;
+		entries[count].count = profiler->counts[i];
+		entries[count].nanoseconds = profiler->nanoseconds[i];
+		count++;
+	}
+
+	qsort(entries, count, sizeof(ProfileEntry), compareTime);
+	return count;
+}
+
+static ProfileEntry* collectPairs(Profiler* profiler, int* countPtr) {
+	int count = 0;
+
+	for (int i = 0; i < 256 * 256; i++) {
+		if (profiler->pairs[i] != 0) {
+			count++;
+		}
+	}
+
+	ProfileEntry* entries = ALLOCATE(ProfileEntry, count);
+	int index = 0;
+
+	for (int i = 0; i < 256 * 256; i++) {
+		if (profiler->pairs[i] == 0) {
+			continue;
+		}
+
+		entries[index].first = i / 256;
+		entries[index].second = i % 256;
+		entries[index].count = profiler->pairs[i];
+		entries[index].nanoseconds = 0;
+		index++;
+	}
+
+	qsort(entries, count, sizeof(ProfileEntry), compareCount);
+
+	*countPtr = count;
+	return entries;
+}
+
+//exposed functions
+void initProfiler(Profiler* profiler) {
+	memset(profiler->counts, 0, sizeof(profiler->counts));
+	memset(profiler->nanoseconds, 0, sizeof(profiler->nanoseconds));
+	profiler->pairs = ALLOCATE(unsigned long long, 256 * 256);
+	memset(profiler->pairs, 0, sizeof(unsigned long long) * 256 * 256);
+	profiler->previous = -1;
+	profiler->timestamp = 0;
+}
+
+void freeProfiler(Profiler* profiler) {
+	FREE_ARRAY(unsigned long long, profiler->pairs, 256 * 256);
+	profiler->pairs = NULL;
+	profiler->previous = -1;
+}
+
+void recordProfiler(Profiler* profiler, unsigned char opcode) {
+	const unsigned long long timestamp = readClock();
+
+	//the previous instruction ran until now
+	if (profiler->previous >= 0) {
+		profiler->nanoseconds[profiler->previous] += timestamp - profiler->timestamp;
+		profiler->pairs[profiler->previous * 256 + opcode]++;
+	}
+
+	profiler->counts[opcode]++;
+	profiler->previous = opcode;
+	profiler->timestamp = timestamp;
+}
+
+void finishProfiler(Profiler* profiler) {
+	if (profiler->previous >= 0) {
+		profiler->nanoseconds[profiler->previous] += readClock() - profiler->timestamp;
+	}
+
+	profiler->previous = -1;
+}
+
+void printProfiler(Profiler* profiler, FILE* out) {
+	ProfileEntry entries[256];
+	const int count = collectOpcodes(profiler, entries);
+
+	unsigned long long totalCount = 0;
+	unsigned long long totalTime = 0;
+
+	for (int i = 0; i < count; i++) {
+		totalCount += entries[i].count;
+		totalTime += entries[i].nanoseconds;
+	}
+
+	fprintf(out, "--profile--\n");
+	fprintf(out, "%-16s %14s %14s %10s %7s\n", "opcode", "count", "total ms", "ns/op", "time %");
+
+	for (int i = 0; i < count; i++) {
+		fprintf(out, "%-16s %14llu %14.3f %10.1f %6.2f%%\n",
+			opcodeName(entries[i].first),
+			entries[i].count,
+			entries[i].nanoseconds / 1e6,
+			(double)entries[i].nanoseconds / entries[i].count,
+			totalTime ? 100.0 * entries[i].nanoseconds / totalTime : 0.0
+		);
+	}
+
+	fprintf(out, "%-16s %14llu %14.3f\n", "total", totalCount, totalTime / 1e6);
+
+	//the most common pairs are candidates for fused instructions
+	int pairCount = 0;
+	ProfileEntry* pairs = collectPairs(profiler, &pairCount);
+
+	fprintf(out, "--pairs--\n");
+
+	for (int i = 0; i < pairCount && i < PAIR_REPORT_LIMIT; i++) {
+		fprintf(out, "%-16s %-16s %14llu\n", opcodeName(pairs[i].first), opcodeName(pairs[i].second), pairs[i].count);
+	}
+
+	FREE_ARRAY(ProfileEntry, pairs, pairCount);
+}
+
+void writeProfilerJson(Profiler* profiler, FILE* out) {
+	ProfileEntry entries[256];
+	const int count = collectOpcodes(profiler, entries);
+
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"opcodes\": [\n");
+
+	for (int i = 0; i < count; i++) {
+		fprintf(out, "\t\t{\"opcode\": %d, \"name\": \"%s\", \"count\": %llu, \"nanoseconds\": %llu}%s\n",
+			entries[i].first,
+			opcodeName(entries[i].first),
+			entries[i].count,
+			entries[i].nanoseconds,
+			i + 1 < count ? "," : ""
+		);
+	}
+
+	fprintf(out, "\t],\n");
+
+	int pairCount = 0;
+	ProfileEntry* pairs = collectPairs(profiler, &pairCount);
+
+	fprintf(out, "\t\"pairs\": [\n");
+
+	for (int i = 0; i < pairCount; i++) {
+		fprintf(out, "\t\t{\"first\": \"%s\", \"second\": \"%s\", \"count\": %llu}%s\n",
+			opcodeName(pairs[i].first),
+			opcodeName(pairs[i].second),
+			pairs[i].count,
+			i + 1 < pairCount ? "," : ""
+		);
+	}
+
+	fprintf(out, "\t]\n");
+	fprintf(out, "}\n");
+
+	FREE_ARRAY(ProfileEntry, pairs, pairCount);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+#include "opcodes.h"
+
+#include <stdio.h>
+
+//DOCS: the profiler counts and times every instruction the interpreter executes, as well as pairs of consecutive instructions
+typedef struct Profiler {
+	unsigned long long counts[256];
+	unsigned long long nanoseconds[256]; //exclusive, groupings don't include their contents
+	unsigned long long* pairs; //256 * 256, indexed by the first opcode then the second
+	int previous; //the last opcode dispatched, or -1
+	unsigned long long timestamp; //when the previous opcode was dispatched
+} Profiler;
+
+void initProfiler(Profiler* profiler);
+void freeProfiler(Profiler* profiler);
+
+//called by the interpreter on each dispatch
+void recordProfiler(Profiler* profiler, unsigned char opcode);
+
+//attributes the time of the final instruction, call once execution ends
+void finishProfiler(Profiler* profiler);
+
+//sorted reports
+void printProfiler(Profiler* profiler, FILE* out);
+void writeProfilerJson(Profiler* profiler, FILE* out);
@@ -0,0 +1,104 @@
+#include "program.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "memory.h"
+
+#include <string.h>
+
+Program* compileProgram(char* source, int optimize) {
+	return compileProgramLength(source, strlen(source), optimize, NULL);
+}
+
+Program* compileProgramLength(char* source, size_t length, int optimize, PrintFn errorOutput) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexerLength(&lexer, source, length);
+	initParserOutput(&parser, &lexer, errorOutput);
+	parser.optimize = optimize;
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	if (optimize == 0) {
+		//without optimizations there's no use for the nodes
+		while (!parser.error && writeParser(&parser, &compiler));
+	}
+	else {
+		NodeArray nodes;
+		initNodeArray(&nodes);
+
+		while(scanParser(&parser, &nodes) && !parser.error) {
+			writeCompiler(&compiler, &nodes);
+			clearNodeArray(&nodes);
+		}
+
+		freeNodeArray(&nodes);
+	}
+
+	//pack up and leave
+	if (parser.error) {
+		freeCompiler(&compiler);
+		freeParser(&parser);
+		return NULL;
+	}
+
+	//take the compiler's output as is, there's no need to collate it and load it back
+	Program* program = ALLOCATE(Program, 1);
+
+	program->bytecode = releaseCompiler(&compiler, &program->length, &program->literalCache, &program->lines);
+	program->codeStart = 0;
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+
+	return program;
+}
+
+Program* loadProgram(unsigned char* bytecode, int length) {
+	//decode the data section once, with a throwaway interpreter
+	Interpreter interpreter;
+	initInterpreter(&interpreter, bytecode, length);
+
+	if (!loadInterpreter(&interpreter)) {
+		freeInterpreter(&interpreter);
+		return NULL;
+	}
+
+	//take over everything the interpreter loaded
+	Program* program = ALLOCATE(Program, 1);
+
+	program->bytecode = interpreter.bytecode;
+	program->length = interpreter.length;
+	program->codeStart = interpreter.codeStart;
+	program->literalCache = interpreter.literalCache;
+	program->lines = interpreter.lines;
+
+	interpreter.borrowed = true;
+	freeInterpreter(&interpreter);
+
+	return program;
+}
+
+void freeProgram(Program* program) {
+	freeLiteralArray(&program->literalCache);
+	freeLineTable(&program->lines);
+	FREE_ARRAY(unsigned char, program->bytecode, program->length);
+	FREE(Program, program);
+}
+
+void bindProgram(Program* program, Interpreter* interpreter) {
+	initInterpreterShared(interpreter, &program->literalCache, &program->lines, program->bytecode, program->length, program->codeStart);
+}
+
+void runProgram(Program* program) {
+	Interpreter interpreter;
+
+	bindProgram(program, &interpreter);
+	runInterpreter(&interpreter);
+	freeInterpreter(&interpreter);
+}
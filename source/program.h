@@ -0,0 +1,27 @@
+#pragma once
+
+#include "interpreter.h"
+
+//DOCS: a program is compiled once, then executed any number of times, possibly from several threads at once
+//it never changes after creation, each execution gets its own interpreter that shares the program's literals and code
+typedef struct Program {
+	unsigned char* bytecode; //the whole collated bytecode
+	int length;
+	int codeStart;
+	LiteralArray literalCache;
+	LineTable lines;
+} Program;
+
+//both return NULL on failure, loadProgram takes ownership of the bytecode either way
+Program* compileProgram(char* source, int optimize);
+
+//the source doesn't need to be terminated, and errors go to errorOutput instead of stderr when it's not NULL
+Program* compileProgramLength(char* source, size_t length, int optimize, PrintFn errorOutput);
+Program* loadProgram(unsigned char* bytecode, int length);
+void freeProgram(Program* program);
+
+//prepare an interpreter to execute the program, free it with freeInterpreter() as usual
+void bindProgram(Program* program, Interpreter* interpreter);
+
+//execute with the default output
+void runProgram(Program* program);
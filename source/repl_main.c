@@ -2,8 +2,16 @@
 
 #include "lexer.h"
 #include "parser.h"
+#include "token_buffer.h"
 #include "compiler.h"
 #include "interpreter.h"
+#include "session.h"
+#include "batch.h"
+#include "server.h"
+#include "parallel.h"
+#include "stats.h"
+#include "sampler.h"
+#include "trace.h"
 
 #include "memory.h"
 
@@ -11,147 +19,359 @@
 #include <stdlib.h>
 #include <string.h>
 
-//read a file and return it as a char array
-char* readFile(char* path) {
-	FILE* file = fopen(path, "rb");
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-	if (file == NULL) {
+#define SAMPLER_FREQUENCY 997 //prime, to avoid aliasing with periodic work
+
+//map a file into memory, read only and not terminated, release it with munmap(source, size)
+//the pages are read in as the lexer reaches them, so lexing starts without waiting for the whole file
+char* mapFile(char* path, size_t* size) {
+	int file = open(path, O_RDONLY);
+
+	if (file < 0) {
 		fprintf(stderr, "Could not open file \"%s\"\n", path);
 		exit(74);
 	}
 
-	fseek(file, 0L, SEEK_END);
-	size_t fileSize = ftell(file);
-	rewind(file);
+	struct stat info;
 
-	char* buffer = (char*)malloc(fileSize + 1);
-
-	if (buffer == NULL) {
-		fprintf(stderr, "Not enough memory to read \"%s\"\n", path);
+	if (fstat(file, &info) < 0) {
+		fprintf(stderr, "Could not read file \"%s\"\n", path);
 		exit(74);
 	}
 
-	size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
+	*size = info.st_size;
 
-	if (bytesRead < fileSize) {
+	//there's nothing to map
+	if (*size == 0) {
+		close(file);
+		return NULL;
+	}
+
+	char* source = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+
+	if (source == MAP_FAILED) {
 		fprintf(stderr, "Could not read file \"%s\"\n", path);
 		exit(74);
 	}
 
+	madvise(source, *size, MADV_SEQUENTIAL);
+
+	//the mapping keeps the file open
+	close(file);
+
+	return source;
+}
+
+void reportProfiler(Profiler* profiler) {
+	if (!command.profileJson) {
+		printProfiler(profiler, stderr);
+		return;
+	}
+
+	FILE* file = fopen(command.profileJson, "w");
+
+	if (file == NULL) {
+		fprintf(stderr, "Could not open file \"%s\"\n", command.profileJson);
+		return;
+	}
+
+	writeProfilerJson(profiler, file);
 	fclose(file);
+}
+
+void reportStats(Stats* stats) {
+	if (!command.statsJson) {
+		printStats(stats, stderr);
+		return;
+	}
 
-	buffer[bytesRead] = '\0';
+	FILE* file = fopen(command.statsJson, "w");
+
+	if (file == NULL) {
+		fprintf(stderr, "Could not open file \"%s\"\n", command.statsJson);
+		return;
+	}
+
+	writeStatsJson(stats, file);
+	fclose(file);
+}
+
+void reportSampler(Sampler* sampler) {
+	if (!command.sampleFolded) {
+		printSampler(sampler, stderr);
+		return;
+	}
+
+	FILE* file = fopen(command.sampleFolded, "w");
+
+	if (file == NULL) {
+		fprintf(stderr, "Could not open file \"%s\"\n", command.sampleFolded);
+		return;
+	}
+
+	writeSamplerFolded(sampler, file, command.filename ? command.filename : "input");
+	fclose(file);
+}
 
-	return buffer;
+InterpreterLimits readLimits() {
+	return (InterpreterLimits){ command.maxInstructions, command.maxSeconds, command.maxStack, command.maxBytes };
 }
 
-void runString(char* source) {
+//the source doesn't need to be terminated
+void runString(char* source, size_t length) {
 	Lexer lexer;
 	Parser parser;
 	Compiler compiler;
 	Interpreter interpreter;
+	Profiler profiler;
+	Sampler sampler;
+	Stats stats;
+
+	initStats(&stats, command.stats);
+
+	initLexerLength(&lexer, source, length);
+	lexer.verbose = command.verbose;
+
+	//the parallel chunks are lexed by their own workers
+	const bool buffered = command.tokens && !command.parallel;
+	TokenBuffer tokens;
+
+	if (buffered) {
+		beginStats(&stats, PHASE_LEX);
+		initTokenBuffer(&tokens, &lexer);
+		endStats(&stats);
+
+		initParserTokens(&parser, &tokens);
+	}
+	else {
+		initParser(&parser, &lexer);
+	}
 
-	initLexer(&lexer, source);
-	initParser(&parser, &lexer);
+	parser.optimize = command.optimize;
 	initCompiler(&compiler);
 
+	//only keep the line table when something will read it
+	const bool lines = command.sample || command.verbose;
+
 	//run the parser until the end of the source
-	Node* node = scanParser(&parser);
-	while(node != NULL) {
-		//pack up and leave
-		if (node->type == NODE_ERROR) {
-			freeNode(node);
-			freeCompiler(&compiler);
-			freeParser(&parser);
-			return;
+	if (command.parallel) {
+		//the chunks are parsed and compiled together, so it's all timed as parsing, the first token has already been checked
+		beginStats(&stats, PHASE_PARSE);
+		parser.error = parser.error || !writeParallel(&compiler, source, length, parser.optimize, lines, command.jobs);
+		endStats(&stats);
+	}
+	else if (parser.optimize == 0) {
+		//without optimizations there's no use for the nodes, so the parser writes the bytecode itself
+		beginStats(&stats, PHASE_PARSE);
+
+		while (!parser.error) {
+			if (lines && parser.current.type != TOKEN_EOF) {
+				markCompilerLine(&compiler, findParserLine(&parser, parser.current));
+			}
+
+			if (!writeParser(&parser, &compiler)) {
+				break;
+			}
 		}
 
-		writeCompiler(&compiler, node);
-		freeNode(node);
-		node = scanParser(&parser);
+		endStats(&stats);
 	}
+	else {
+		NodeArray nodes;
+		initNodeArray(&nodes);
 
-	//get the bytecode dump
+		beginStats(&stats, PHASE_PARSE);
+		bool scanned = scanParser(&parser, &nodes);
+		endStats(&stats);
+
+		while(scanned && !parser.error) {
+			if (lines) {
+				markCompilerLine(&compiler, findParserLine(&parser, parser.statement));
+			}
+
+			beginStats(&stats, PHASE_COMPILE);
+			writeCompiler(&compiler, &nodes);
+			clearNodeArray(&nodes);
+			endStats(&stats);
+
+			beginStats(&stats, PHASE_PARSE);
+			scanned = scanParser(&parser, &nodes);
+			endStats(&stats);
+		}
+
+		freeNodeArray(&nodes);
+	}
+
+	//pack up and leave
+	if (parser.error) {
+		freeCompiler(&compiler);
+		freeParser(&parser);
+
+		if (buffered) {
+			freeTokenBuffer(&tokens);
+		}
+
+		return;
+	}
+
+	stats.literalCount = compiler.literalCache.count;
+
+	//the code is executed right here, so it's handed over as is, rather than collated and loaded back
 	int size = 0;
-	char* tb = collateCompiler(&compiler, &size);
+	LiteralArray literals;
+	LineTable lineTable;
+
+	beginStats(&stats, PHASE_HANDOFF);
+	unsigned char* code = releaseCompiler(&compiler, &size, &literals, &lineTable);
 
 	//cleanup
 	freeCompiler(&compiler);
 	freeParser(&parser);
 
-	//run the bytecode
-	initInterpreter(&interpreter, tb, size);
+	if (buffered) {
+		freeTokenBuffer(&tokens);
+	}
+	endStats(&stats);
+
+	stats.bytecodeSize = size;
+
+	//run the code
+	beginStats(&stats, PHASE_INIT);
+	initInterpreterCode(&interpreter, &literals, &lineTable, code, size);
+	interpreter.verbose = command.verbose;
+	interpreter.limits = readLimits();
+
+	if (command.profile) {
+		initProfiler(&profiler);
+		setInterpreterProfiler(&interpreter, &profiler);
+	}
+	endStats(&stats);
+
+	if (command.sample && !startSampler(&sampler, &interpreter, SAMPLER_FREQUENCY)) {
+		fprintf(stderr, "Could not start the sampler\n");
+		command.sample = false;
+	}
+
+	beginStats(&stats, PHASE_EXECUTE);
 	runInterpreter(&interpreter);
+	endStats(&stats);
+
+	if (describeInterpreterStatus(interpreter.status)) {
+		fprintf(stderr, "%s\n", describeInterpreterStatus(interpreter.status));
+	}
+
+	if (command.sample) {
+		stopSampler(&sampler);
+		reportSampler(&sampler);
+		freeSampler(&sampler);
+	}
+
+	stats.instructions = interpreter.instructions;
+
+	if (command.profile) {
+		finishProfiler(&profiler);
+		reportProfiler(&profiler);
+		freeProfiler(&profiler);
+	}
+
 	freeInterpreter(&interpreter);
-}
 
-void runFile(char* fname) {
-	char* source = readFile(fname);
-	runString(source);
-	free((void*)source);
+	if (command.stats) {
+		reportStats(&stats);
+	}
 }
 
-void repl() {
-	bool error = false;
+//execute each statement as it arrives, so a generator can pipe in a script of any length
+void runStream(Lexer* lexer) {
+	lexer->verbose = command.verbose;
 
-	const int size = 2048;
-	char input[size];
-	memset(input, 0, size);
+	Session session;
+	initSession(&session);
+	session.optimize = command.optimize;
+	session.interpreter.verbose = command.verbose;
+	session.interpreter.limits = readLimits();
 
-	Interpreter interpreter; //persist the interpreter for the scopes
+	Profiler profiler;
 
-	for(;;) {
-		printf("> ");
-		fgets(input, size, stdin);
+	if (command.profile) {
+		initProfiler(&profiler);
+		setInterpreterProfiler(&session.interpreter, &profiler);
+	}
 
-		//setup this iteration
-		Lexer lexer;
-		Parser parser;
-		Compiler compiler;
+	streamSession(&session, lexer);
 
-		initLexer(&lexer, input);
-		initParser(&parser, &lexer);
-		initCompiler(&compiler);
-
-		//run this iteration
-		Node* node = scanParser(&parser);
-		while(node != NULL) {
-			//pack up and restart
-			if (node->type == NODE_ERROR) {
-				error = true;
-				freeNode(node);
-				break;
-			}
+	if (describeInterpreterStatus(session.interpreter.status)) {
+		fprintf(stderr, "%s\n", describeInterpreterStatus(session.interpreter.status));
+	}
+
+	if (command.profile) {
+		finishProfiler(&profiler);
+		reportProfiler(&profiler);
+		freeProfiler(&profiler);
+	}
+
+	freeSession(&session);
+}
+
+void runFile(char* fname) {
+	//stdin can only be streamed
+	if (command.stream || !strcmp(fname, "-")) {
+		int file = strcmp(fname, "-") ? open(fname, O_RDONLY) : STDIN_FILENO;
 
-			writeCompiler(&compiler, node);
-			freeNode(node);
-			node = scanParser(&parser);
+		if (file < 0) {
+			fprintf(stderr, "Could not open file \"%s\"\n", fname);
+			exit(74);
 		}
 
-		if (!error) {
-			//get the bytecode dump
-			int size = 0;
-			char* tb = collateCompiler(&compiler, &size);
+		Lexer lexer;
+		initLexerStream(&lexer, file);
+		runStream(&lexer);
+		freeLexer(&lexer);
+
+		if (file != STDIN_FILENO) {
+			close(file);
+		}
+
+		return;
+	}
 
-			// for (int i = 0; i < size; i++) {
-			// 	printf("%d ", tb[i]);
-			// }
+	size_t size = 0;
+	char* source = mapFile(fname, &size);
+
+	if (source == NULL) {
+		runString("", 0);
+		return;
+	}
+
+	runString(source, size);
+	munmap(source, size);
+}
 
-			// printf("\n");
+void repl() {
+	const int size = 2048;
+	char input[size];
+	memset(input, 0, size);
+
+	Session session; //persist the compiler and interpreter across lines
+	initSession(&session);
+	session.optimize = command.optimize;
+	session.interpreter.verbose = command.verbose;
+
+	for(;;) {
+		printf("> ");
 
-			//run the bytecode
-			initInterpreter(&interpreter, tb, size);
-			runInterpreter(&interpreter);
-			freeInterpreter(&interpreter); //TODO: option to retain the scopes
+		if (fgets(input, size, stdin) == NULL) {
+			break;
 		}
 
-		//clean up this iteration
-		freeCompiler(&compiler);
-		freeParser(&parser);
-		error = false;
+		runSession(&session, input);
 	}
 
-	freeInterpreter(&interpreter);
+	freeSession(&session);
 }
 
 //entry point
@@ -179,13 +399,57 @@ int main(int argc, const char* argv[]) {
 		printf("Warning! This interpreter is a work in progress, it does not yet meet the %d.%d.%d specification.\n", TOY_VERSION_MAJOR, TOY_VERSION_MINOR, TOY_VERSION_PATCH);
 	}
 
+	if (command.trace && !openTrace(command.trace)) {
+		fprintf(stderr, "Could not open file \"%s\"\n", command.trace);
+		return -1;
+	}
+
+	if (command.serve) {
+		InterpreterLimits limits = readLimits();
+		int result = runServer(command.serve, command.jobs, command.cacheSize, command.optimize, &limits);
+		closeTrace();
+		return result;
+	}
+
+	if (command.batch) {
+		Batch batch;
+		initBatch(&batch);
+		batch.optimize = command.optimize;
+		batch.limits = readLimits();
+
+		for (int i = 0; i < command.scriptCount; i++) {
+			if (!pushBatch(&batch, command.scripts[i])) {
+				fprintf(stderr, "Could not open file \"%s\"\n", command.scripts[i] + 1);
+				freeBatch(&batch);
+				closeTrace();
+				return -1;
+			}
+		}
+
+		int failures = runBatch(&batch, command.jobs);
+
+		freeBatch(&batch);
+		closeTrace();
+		return failures > 0 ? 1 : 0;
+	}
+
 	if (command.filename) {
 		runFile(command.filename);
+		closeTrace();
+		return 0;
+	}
+
+	if (command.source && command.stream) {
+		Lexer lexer;
+		initLexerLength(&lexer, command.source, strlen(command.source));
+		runStream(&lexer);
+		closeTrace();
 		return 0;
 	}
 
 	if (command.source) {
-		runString(command.source);
+		runString(command.source, strlen(command.source));
+		closeTrace();
 		return 0;
 	}
 
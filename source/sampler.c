@@ -0,0 +1,209 @@
+#define _GNU_SOURCE //for mremap() and SIGEV_THREAD_ID
+
+#include "sampler.h"
+
+#include "memory.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//older glibc only has the raw field
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+//a typical run takes tens of samples, so start small and double up to roughly an hour of CPU time at the default frequency
+#define SAMPLER_INITIAL 1024
+#define SAMPLER_CAPACITY (1 << 22)
+
+typedef struct {
+	int line;
+	int hits;
+} SampleLine;
+
+//the signal handler can only reach the active sampler through this
+static Sampler* volatile activeSampler = NULL;
+
+//the samples are mapped rather than allocated, since malloc() isn't safe in a signal handler but the mapping can be grown there
+static bool growSamples(Sampler* sampler) {
+	if (sampler->capacity >= SAMPLER_CAPACITY) {
+		return false;
+	}
+
+	void* samples = mremap(sampler->samples, sizeof(int) * sampler->capacity, sizeof(int) * sampler->capacity * 2, MREMAP_MAYMOVE);
+
+	if (samples == MAP_FAILED) {
+		return false;
+	}
+
+	sampler->samples = samples;
+	sampler->capacity *= 2;
+	return true;
+}
+
+static void sampleHandler(int signal) {
+	Sampler* sampler = activeSampler;
+
+	if (sampler == NULL) {
+		return;
+	}
+
+	if (sampler->count >= sampler->capacity && !growSamples(sampler)) {
+		sampler->dropped++;
+		return;
+	}
+
+	//the interpreter's position is just past the instruction being executed
+	sampler->samples[sampler->count++] = sampler->interpreter->count - 1 - sampler->interpreter->codeStart;
+}
+
+static int compareHits(const void* lhs, const void* rhs) {
+	const SampleLine* a = lhs;
+	const SampleLine* b = rhs;
+
+	if (a->hits != b->hits) {
+		return b->hits - a->hits;
+	}
+
+	return a->line - b->line;
+}
+
+static int compareLines(const void* lhs, const void* rhs) {
+	return ((const SampleLine*)lhs)->line - ((const SampleLine*)rhs)->line;
+}
+
+//count the hits for each line, sorted by line number
+static SampleLine* collectLines(Sampler* sampler, int* countPtr) {
+	SampleLine* lines = ALLOCATE(SampleLine, sampler->count);
+
+	for (int i = 0; i < sampler->count; i++) {
+		lines[i].line = findLineTable(&sampler->interpreter->lines, sampler->samples[i]);
+		lines[i].hits = 1;
+	}
+
+	qsort(lines, sampler->count, sizeof(SampleLine), compareLines);
+
+	//merge runs of the same line
+	int count = 0;
+	for (int i = 0; i < sampler->count; i++) {
+		if (count > 0 && lines[count - 1].line == lines[i].line) {
+			lines[count - 1].hits++;
+			continue;
+		}
+
+		lines[count++] = lines[i];
+	}
+
+	*countPtr = count;
+	return lines;
+}
+
+//exposed functions
+bool startSampler(Sampler* sampler, Interpreter* interpreter, int frequency) {
+	if (activeSampler != NULL || frequency <= 0) {
+		return false;
+	}
+
+	sampler->interpreter = interpreter;
+	sampler->capacity = SAMPLER_INITIAL;
+	sampler->samples = mmap(NULL, sizeof(int) * sampler->capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	sampler->count = 0;
+	sampler->dropped = 0;
+
+	if (sampler->samples == MAP_FAILED) {
+		sampler->samples = NULL;
+		sampler->capacity = 0;
+		return false;
+	}
+
+	//a process-wide timer could signal any thread, so this one counts and signals only the calling thread
+	struct sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event.sigev_notify_thread_id = syscall(SYS_gettid);
+
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &sampler->timer) != 0) {
+		munmap(sampler->samples, sizeof(int) * sampler->capacity);
+		sampler->samples = NULL;
+		sampler->capacity = 0;
+		return false;
+	}
+
+	activeSampler = sampler;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = sampleHandler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, NULL);
+
+	struct itimerspec timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_nsec = 1000000000L / frequency;
+	timer.it_value = timer.it_interval;
+	timer_settime(sampler->timer, 0, &timer, NULL);
+
+	return true;
+}
+
+void stopSampler(Sampler* sampler) {
+	timer_delete(sampler->timer);
+
+	signal(SIGPROF, SIG_IGN);
+	activeSampler = NULL;
+}
+
+void freeSampler(Sampler* sampler) {
+	if (sampler->samples != NULL) {
+		munmap(sampler->samples, sizeof(int) * sampler->capacity);
+	}
+
+	sampler->samples = NULL;
+	sampler->capacity = 0;
+	sampler->count = 0;
+}
+
+void printSampler(Sampler* sampler, FILE* out) {
+	int count = 0;
+	SampleLine* lines = collectLines(sampler, &count);
+
+	qsort(lines, count, sizeof(SampleLine), compareHits);
+
+	fprintf(out, "--samples--\n");
+	fprintf(out, "%-10s %10s %8s\n", "line", "hits", "%");
+
+	for (int i = 0; i < count; i++) {
+		fprintf(out, "%-10d %10d %7.2f%%\n", lines[i].line, lines[i].hits, 100.0 * lines[i].hits / sampler->count);
+	}
+
+	fprintf(out, "%-10s %10d", "total", sampler->count);
+
+	if (sampler->dropped > 0) {
+		fprintf(out, " (%d dropped)", sampler->dropped);
+	}
+
+	fprintf(out, "\n");
+
+	if (sampler->interpreter->lines.count == 0) {
+		fprintf(out, "No line table was found, every sample is attributed to line 0\n");
+	}
+
+	FREE_ARRAY(SampleLine, lines, sampler->count);
+}
+
+void writeSamplerFolded(Sampler* sampler, FILE* out, const char* name) {
+	int count = 0;
+	SampleLine* lines = collectLines(sampler, &count);
+
+	for (int i = 0; i < count; i++) {
+		fprintf(out, "%s;line %d %d\n", name, lines[i].line, lines[i].hits);
+	}
+
+	FREE_ARRAY(SampleLine, lines, sampler->count);
+}
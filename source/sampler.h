@@ -0,0 +1,27 @@
+#pragma once
+
+#include "interpreter.h"
+
+#include <stdio.h>
+#include <time.h>
+
+//DOCS: the sampler periodically records which instruction the interpreter is executing, using SIGPROF
+//only one sampler can run at a time, and it must be started on the interpreter's thread, since its timer counts that thread's CPU time and signals only that thread
+typedef struct Sampler {
+	Interpreter* interpreter;
+	timer_t timer;
+	int* samples; //offsets into the code section, grown as they arrive
+	int capacity;
+	int count;
+	int dropped; //samples taken once the buffer was full
+} Sampler;
+
+bool startSampler(Sampler* sampler, Interpreter* interpreter, int frequency);
+void stopSampler(Sampler* sampler);
+void freeSampler(Sampler* sampler);
+
+//per-line hit counts, busiest first
+void printSampler(Sampler* sampler, FILE* out);
+
+//folded stacks, for flame graph tools
+void writeSamplerFolded(Sampler* sampler, FILE* out, const char* name);
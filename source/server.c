@@ -0,0 +1,680 @@
+#include "server.h"
+
+#include "memory.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_BUFFER 4096 //output is flushed to the client in frames of about this size
+#define SERVER_STALL_SECONDS 5 //a client that stops partway through a frame, in either direction, is dropped after this long
+
+//one client connection, owned by the polling thread while it's idle, and by one worker while a request is served
+typedef struct Connection {
+	int fd;
+	bool failed; //the client went away
+
+	char kind; //of the pending output
+	char buffer[SERVER_BUFFER];
+	int count;
+
+	bool asserted;
+} Connection;
+
+typedef struct Server {
+	ProgramCache cache;
+	int optimize;
+	InterpreterLimits limits; //without the time, which is up to the watchdog
+	double seconds;
+	Watchdog watchdog;
+
+	//connections with a request waiting, handed from the polling thread to the workers
+	Connection** pending;
+	int capacity;
+	int head;
+	int count;
+
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+
+	//connections handed back by the workers once their request is answered
+	Connection** returned;
+	int returnedCapacity;
+	int returnedCount;
+	int wake[2]; //a byte is written for each one returned, so the polling thread notices
+} Server;
+
+//the connection served by the calling thread, for the output callbacks
+static _Thread_local Connection* serving = NULL;
+
+static unsigned long long hashSource(const char* source, int length) {
+	unsigned long long hash = 0xcbf29ce484222325ull;
+
+	for (int i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)source[i]) * 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+//the program cache
+void initProgramCache(ProgramCache* cache, int capacity) {
+	cache->entries = ALLOCATE(CachedProgram*, capacity);
+	cache->capacity = capacity;
+	cache->count = 0;
+	cache->clock = 0;
+	pthread_mutex_init(&cache->lock, NULL);
+}
+
+static void freeCachedProgram(CachedProgram* entry) {
+	freeProgram(entry->program);
+	FREE_ARRAY(char, entry->source, entry->length);
+	FREE(CachedProgram, entry);
+}
+
+static bool matchCachedProgram(CachedProgram* entry, unsigned long long hash, const char* source, int length) {
+	return entry->hash == hash && (source == NULL || (entry->length == length && memcmp(entry->source, source, length) == 0));
+}
+
+//called with the lock held
+static void removeCachedProgram(ProgramCache* cache, int index) {
+	CachedProgram* removed = cache->entries[index];
+	cache->entries[index] = cache->entries[--cache->count];
+
+	removed->cached = false;
+
+	if (removed->refs == 0) {
+		freeCachedProgram(removed);
+	}
+}
+
+void freeProgramCache(ProgramCache* cache) {
+	for (int i = 0; i < cache->count; i++) {
+		freeCachedProgram(cache->entries[i]);
+	}
+
+	FREE_ARRAY(CachedProgram*, cache->entries, cache->capacity);
+	cache->entries = NULL;
+	cache->capacity = 0;
+	cache->count = 0;
+	pthread_mutex_destroy(&cache->lock);
+}
+
+CachedProgram* findProgramCache(ProgramCache* cache, unsigned long long hash, const char* source, int length) {
+	CachedProgram* found = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (int i = 0; i < cache->count; i++) {
+		if (matchCachedProgram(cache->entries[i], hash, source, length)) {
+			found = cache->entries[i];
+			found->used = ++cache->clock;
+			found->refs++;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+CachedProgram* insertProgramCache(ProgramCache* cache, unsigned long long hash, const char* source, int length, Program* program) {
+	CachedProgram* entry = ALLOCATE(CachedProgram, 1);
+
+	entry->program = program;
+	entry->hash = hash;
+	entry->source = ALLOCATE(char, length);
+	entry->length = length;
+	memcpy(entry->source, source, length);
+	entry->refs = 1;
+	entry->cached = true;
+
+	pthread_mutex_lock(&cache->lock);
+
+	entry->used = ++cache->clock;
+
+	for (int i = 0; i < cache->count; i++) {
+		if (cache->entries[i]->hash != hash) {
+			continue;
+		}
+
+		//another worker compiled the same source first, keep theirs
+		if (matchCachedProgram(cache->entries[i], hash, source, length)) {
+			CachedProgram* found = cache->entries[i];
+			found->used = entry->used;
+			found->refs++;
+			pthread_mutex_unlock(&cache->lock);
+
+			freeCachedProgram(entry);
+			return found;
+		}
+
+		//a collision, so the hash only ever names the newest source
+		removeCachedProgram(cache, i);
+		break;
+	}
+
+	//make room by evicting the least recently used
+	if (cache->count == cache->capacity) {
+		int oldest = 0;
+
+		for (int i = 1; i < cache->count; i++) {
+			if (cache->entries[i]->used < cache->entries[oldest]->used) {
+				oldest = i;
+			}
+		}
+
+		removeCachedProgram(cache, oldest);
+	}
+
+	cache->entries[cache->count++] = entry;
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return entry;
+}
+
+void releaseProgramCache(ProgramCache* cache, CachedProgram* entry) {
+	pthread_mutex_lock(&cache->lock);
+	bool orphaned = --entry->refs == 0 && !entry->cached;
+	pthread_mutex_unlock(&cache->lock);
+
+	if (orphaned) {
+		freeCachedProgram(entry);
+	}
+}
+
+//framing
+static bool readAll(int fd, void* buffer, int length) {
+	char* ptr = (char*)buffer;
+
+	while (length > 0) {
+		ssize_t n = recv(fd, ptr, length, 0);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			return false;
+		}
+
+		ptr += n;
+		length -= n;
+	}
+
+	return true;
+}
+
+static bool writeAll(int fd, const void* buffer, int length) {
+	const char* ptr = (const char*)buffer;
+
+	while (length > 0) {
+		ssize_t n = send(fd, ptr, length, MSG_NOSIGNAL);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			return false;
+		}
+
+		ptr += n;
+		length -= n;
+	}
+
+	return true;
+}
+
+static bool writeFrame(Connection* connection, char kind, const char* payload, int length) {
+	unsigned char header[5] = { kind, length & 0xFF, (length >> 8) & 0xFF, (length >> 16) & 0xFF, (length >> 24) & 0xFF };
+
+	if (connection->failed || !writeAll(connection->fd, header, 5) || !writeAll(connection->fd, payload, length)) {
+		connection->failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+static void flushConnection(Connection* connection) {
+	if (connection->count > 0) {
+		writeFrame(connection, connection->kind, connection->buffer, connection->count);
+		connection->count = 0;
+	}
+}
+
+//output is gathered into frames, so chatty programs don't cost a write per line
+static void bufferConnection(Connection* connection, char kind, const char* str) {
+	int length = strlen(str);
+
+	if (connection->kind != kind || connection->count + length > SERVER_BUFFER) {
+		flushConnection(connection);
+		connection->kind = kind;
+	}
+
+	if (length > SERVER_BUFFER) {
+		writeFrame(connection, kind, str, length);
+		return;
+	}
+
+	memcpy(&connection->buffer[connection->count], str, length);
+	connection->count += length;
+}
+
+static void printConnection(const char* output) {
+	bufferConnection(serving, 'O', output);
+	bufferConnection(serving, 'O', "\n");
+}
+
+static void assertConnection(const char* output) {
+	bufferConnection(serving, 'E', "Assertion failure: ");
+	bufferConnection(serving, 'E', output);
+	bufferConnection(serving, 'E', "\n");
+	serving->asserted = true;
+}
+
+static void errorConnection(const char* output) {
+	bufferConnection(serving, 'E', output);
+}
+
+static void finishRequest(Connection* connection, unsigned char status, unsigned long long hash) {
+	unsigned char payload[9] = { status };
+
+	for (int i = 0; i < 8; i++) {
+		payload[i + 1] = (hash >> (i * 8)) & 0xFF;
+	}
+
+	flushConnection(connection);
+	writeFrame(connection, 'D', (char*)payload, 9);
+}
+
+static void failRequest(Connection* connection, unsigned char status, unsigned long long hash, const char* message) {
+	bufferConnection(connection, 'E', message);
+	finishRequest(connection, status, hash);
+}
+
+//returns false if the connection should be closed
+static bool serveRequest(Server* server, Connection* connection) {
+	unsigned char header[5];
+
+	if (!readAll(connection->fd, header, 5)) {
+		return false;
+	}
+
+	char kind = header[0];
+	unsigned int length = header[1] | (header[2] << 8) | (header[3] << 16) | ((unsigned int)header[4] << 24);
+
+	if ((kind != 'S' && kind != 'H') || (kind == 'H' && length != 8) || length > SERVER_MAX_PAYLOAD) {
+		failRequest(connection, SERVER_STATUS_INVALID, 0, "Malformed request\n");
+		return false;
+	}
+
+	char* payload = ALLOCATE(char, length + 1);
+
+	if (!readAll(connection->fd, payload, length)) {
+		FREE_ARRAY(char, payload, length + 1);
+		return false;
+	}
+
+	TRACE_BEGIN_VALUE("server", "request", "bytes", length);
+
+	//find the program
+	unsigned long long hash = 0;
+	CachedProgram* entry = NULL;
+
+	if (kind == 'H') {
+		for (int i = 0; i < 8; i++) {
+			hash |= (unsigned long long)(unsigned char)payload[i] << (i * 8);
+		}
+
+		entry = findProgramCache(&server->cache, hash, NULL, 0);
+	}
+	else {
+		hash = hashSource(payload, length);
+		entry = findProgramCache(&server->cache, hash, payload, length);
+
+		if (entry == NULL) {
+			//the payload isn't terminated, so every byte the hash covers is compiled, and the errors are sent to the client
+			serving = connection;
+			Program* program = compileProgramLength(payload, length, server->optimize, errorConnection);
+			serving = NULL;
+
+			if (program != NULL) {
+				entry = insertProgramCache(&server->cache, hash, payload, length, program);
+			}
+		}
+	}
+
+	FREE_ARRAY(char, payload, length + 1);
+
+	if (entry == NULL) {
+		if (kind == 'H') {
+			failRequest(connection, SERVER_STATUS_UNKNOWN, hash, "No program with that hash is cached\n");
+		}
+		else {
+			failRequest(connection, SERVER_STATUS_COMPILE, hash, "Could not compile the source\n");
+		}
+
+		TRACE_END("server", "request");
+		return !connection->failed;
+	}
+
+	//run it
+	Interpreter interpreter;
+
+	bindProgram(entry->program, &interpreter);
+	setInterpreterPrint(&interpreter, printConnection);
+	setInterpreterAssert(&interpreter, assertConnection);
+	setInterpreterError(&interpreter, errorConnection);
+	interpreter.limits = server->limits;
+
+	if (server->seconds > 0) {
+		watchInterpreter(&server->watchdog, &interpreter, server->seconds);
+	}
+
+	connection->asserted = false;
+	serving = connection;
+	runInterpreter(&interpreter);
+	serving = NULL;
+
+	if (server->seconds > 0) {
+		unwatchInterpreter(&server->watchdog, &interpreter);
+	}
+
+	InterpreterStatus status = interpreter.status;
+
+	freeInterpreter(&interpreter);
+	releaseProgramCache(&server->cache, entry);
+
+	//the watchdog only ever preempts for time
+	if (status == INTERPRETER_PREEMPTED) {
+		status = INTERPRETER_LIMIT_TIME;
+	}
+
+	if (describeInterpreterStatus(status)) {
+		bufferConnection(connection, 'E', describeInterpreterStatus(status));
+		bufferConnection(connection, 'E', "\n");
+		finishRequest(connection, SERVER_STATUS_LIMIT, hash);
+	}
+	else {
+		finishRequest(connection, connection->asserted ? SERVER_STATUS_ASSERT : SERVER_STATUS_OK, hash);
+	}
+
+	TRACE_END("server", "request");
+
+	return !connection->failed;
+}
+
+static void closeConnection(Connection* connection) {
+	close(connection->fd);
+	FREE(Connection, connection);
+}
+
+//hand a connection back to the polling thread, to wait for its next request
+static void returnConnection(Server* server, Connection* connection) {
+	pthread_mutex_lock(&server->lock);
+
+	if (server->returnedCapacity < server->returnedCount + 1) {
+		int oldCapacity = server->returnedCapacity;
+
+		server->returnedCapacity = GROW_CAPACITY(oldCapacity);
+		server->returned = GROW_ARRAY(Connection*, server->returned, oldCapacity, server->returnedCapacity);
+	}
+
+	server->returned[server->returnedCount++] = connection;
+
+	pthread_mutex_unlock(&server->lock);
+
+	char byte = 0;
+	while (write(server->wake[1], &byte, 1) < 0 && errno == EINTR);
+}
+
+static void* runWorker(void* arg) {
+	Server* server = (Server*)arg;
+
+	for (;;) {
+		//wait for a request
+		pthread_mutex_lock(&server->lock);
+
+		while (server->count == 0) {
+			pthread_cond_wait(&server->ready, &server->lock);
+		}
+
+		Connection* connection = server->pending[server->head];
+		server->head = (server->head + 1) % server->capacity;
+		server->count--;
+
+		pthread_mutex_unlock(&server->lock);
+
+		//one request at a time, so an idle client never holds a worker
+		if (serveRequest(server, connection)) {
+			returnConnection(server, connection);
+		}
+		else {
+			closeConnection(connection);
+		}
+	}
+
+	return NULL;
+}
+
+static void pushPending(Server* server, Connection* connection) {
+	pthread_mutex_lock(&server->lock);
+
+	//grow the ring, unwrapping it as it's copied
+	if (server->count == server->capacity) {
+		int oldCapacity = server->capacity;
+		Connection** pending = ALLOCATE(Connection*, GROW_CAPACITY(oldCapacity));
+
+		for (int i = 0; i < server->count; i++) {
+			pending[i] = server->pending[(server->head + i) % oldCapacity];
+		}
+
+		FREE_ARRAY(Connection*, server->pending, oldCapacity);
+		server->pending = pending;
+		server->capacity = GROW_CAPACITY(oldCapacity);
+		server->head = 0;
+	}
+
+	server->pending[(server->head + server->count) % server->capacity] = connection;
+	server->count++;
+
+	pthread_cond_signal(&server->ready);
+	pthread_mutex_unlock(&server->lock);
+}
+
+//the connections waiting for their next request, watched by the polling thread
+typedef struct IdleSet {
+	Connection** connections;
+	int capacity;
+	int count;
+	struct pollfd* fds; //the listener and wake pipe, then one for each connection
+	int fdCapacity;
+} IdleSet;
+
+static void pushIdle(IdleSet* idle, Connection* connection) {
+	if (idle->capacity < idle->count + 1) {
+		int oldCapacity = idle->capacity;
+
+		idle->capacity = GROW_CAPACITY(oldCapacity);
+		idle->connections = GROW_ARRAY(Connection*, idle->connections, oldCapacity, idle->capacity);
+	}
+
+	idle->connections[idle->count++] = connection;
+}
+
+static void acceptConnection(IdleSet* idle, int listener) {
+	int fd = accept(listener, NULL, NULL);
+
+	if (fd < 0) {
+		if (errno != EINTR) {
+			fprintf(stderr, "Could not accept a connection: %s\n", strerror(errno));
+		}
+
+		return;
+	}
+
+	//a worker only blocks on a client that has started a frame, and then not for long
+	struct timeval stall = { SERVER_STALL_SECONDS, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &stall, sizeof(stall));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &stall, sizeof(stall));
+
+	Connection* connection = ALLOCATE(Connection, 1);
+
+	connection->fd = fd;
+	connection->failed = false;
+	connection->kind = 'O';
+	connection->count = 0;
+	connection->asserted = false;
+
+	pushIdle(idle, connection);
+}
+
+//take back the connections the workers have finished with
+static void collectReturned(Server* server, IdleSet* idle) {
+	char bytes[64];
+	while (read(server->wake[0], bytes, sizeof(bytes)) < 0 && errno == EINTR);
+
+	pthread_mutex_lock(&server->lock);
+
+	for (int i = 0; i < server->returnedCount; i++) {
+		pushIdle(idle, server->returned[i]);
+	}
+
+	server->returnedCount = 0;
+
+	pthread_mutex_unlock(&server->lock);
+}
+
+//wait on every idle connection at once, and hand each one with a request waiting to the workers
+static void pollConnections(Server* server, int listener) {
+	IdleSet idle = { NULL, 0, 0, NULL, 0 };
+
+	for (;;) {
+		if (idle.fdCapacity < idle.count + 2) {
+			int oldCapacity = idle.fdCapacity;
+
+			idle.fdCapacity = GROW_CAPACITY(idle.count + 2);
+			idle.fds = GROW_ARRAY(struct pollfd, idle.fds, oldCapacity, idle.fdCapacity);
+		}
+
+		idle.fds[0] = (struct pollfd){ listener, POLLIN, 0 };
+		idle.fds[1] = (struct pollfd){ server->wake[0], POLLIN, 0 };
+
+		for (int i = 0; i < idle.count; i++) {
+			idle.fds[i + 2] = (struct pollfd){ idle.connections[i]->fd, POLLIN, 0 };
+		}
+
+		if (poll(idle.fds, idle.count + 2, -1) < 0) {
+			if (errno != EINTR) {
+				fprintf(stderr, "Could not poll the connections: %s\n", strerror(errno));
+			}
+
+			continue;
+		}
+
+		//a hang up is ready too, the worker notices it and closes the connection
+		int kept = 0;
+
+		for (int i = 0; i < idle.count; i++) {
+			if (idle.fds[i + 2].revents != 0) {
+				pushPending(server, idle.connections[i]);
+			}
+			else {
+				idle.connections[kept++] = idle.connections[i];
+			}
+		}
+
+		idle.count = kept;
+
+		if (idle.fds[1].revents != 0) {
+			collectReturned(server, &idle);
+		}
+
+		if (idle.fds[0].revents != 0) {
+			acceptConnection(&idle, listener);
+		}
+	}
+}
+
+int runServer(const char* path, int jobs, int cacheSize, int optimize, InterpreterLimits* limits) {
+	struct sockaddr_un address;
+
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Socket path is too long \"%s\"\n", path);
+		return -1;
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listener < 0) {
+		fprintf(stderr, "Could not create a socket\n");
+		return -1;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	unlink(path); //left behind by an earlier server
+
+	if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+		fprintf(stderr, "Could not listen on \"%s\"\n", path);
+		close(listener);
+		return -1;
+	}
+
+	if (jobs <= 0) {
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	if (cacheSize <= 0) {
+		cacheSize = 1;
+	}
+
+	//the workers live as long as the process
+	static Server server;
+
+	initProgramCache(&server.cache, cacheSize);
+	server.optimize = optimize;
+	server.limits = *limits;
+	server.limits.seconds = 0;
+	server.seconds = limits->seconds;
+	initWatchdog(&server.watchdog);
+	server.pending = NULL;
+	server.capacity = 0;
+	server.head = 0;
+	server.count = 0;
+	pthread_mutex_init(&server.lock, NULL);
+	pthread_cond_init(&server.ready, NULL);
+	server.returned = NULL;
+	server.returnedCapacity = 0;
+	server.returnedCount = 0;
+
+	if (pipe(server.wake) < 0) {
+		fprintf(stderr, "Could not create the wake pipe\n");
+		close(listener);
+		return -1;
+	}
+
+	for (int i = 0; i < jobs; i++) {
+		pthread_t worker;
+		pthread_create(&worker, NULL, runWorker, &server);
+		pthread_detach(worker);
+	}
+
+	fprintf(stderr, "Serving on \"%s\" with %d workers\n", path, jobs);
+
+	pollConnections(&server, listener);
+
+	return 0;
+}
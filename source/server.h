@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+#include "program.h"
+#include "watchdog.h"
+
+#include <pthread.h>
+
+//DOCS: the server keeps a pool of warm workers and a cache of compiled programs behind a unix socket
+//idle connections are polled by the accepting thread, and a worker is only taken while one request is read and answered
+//every frame, in either direction, is a kind byte, a 4 byte little endian length, then that many bytes of payload
+//
+//requests, any number per connection, each answered in full before the next is read:
+//	'S' source		compile (or find in the cache) and run this source, every byte of the payload is source
+//	'H' hash		run a cached program, the payload is the 8 byte little endian hash returned by an earlier request
+//
+//responses, streamed while the program runs:
+//	'O' text		printed output, one or more lines
+//	'E' text		assertion failures, compile errors, and why a request could not run
+//	'D' status hash	the request is done, a status byte then the program's 8 byte hash
+#define SERVER_STATUS_OK 0
+#define SERVER_STATUS_ASSERT 1 //ran to completion, but an assertion failed
+#define SERVER_STATUS_COMPILE 2 //the source didn't compile
+#define SERVER_STATUS_UNKNOWN 3 //no program with that hash is cached
+#define SERVER_STATUS_INVALID 4 //the request was malformed, and the connection is closed
+#define SERVER_STATUS_LIMIT 5 //stopped for exceeding one of the server's limits
+
+#define SERVER_MAX_PAYLOAD (64 * 1024 * 1024)
+
+//a program shared by the cache and the requests running it
+typedef struct CachedProgram {
+	Program* program;
+	unsigned long long hash; //FNV-1a of the source
+	char* source; //a copy, since the hash alone can be made to collide
+	int length;
+	unsigned long long used; //when this was last requested, for eviction
+	int refs; //requests running it right now
+	bool cached; //false once evicted, the last request frees it
+} CachedProgram;
+
+//least recently used programs are evicted first
+typedef struct ProgramCache {
+	CachedProgram** entries;
+	int capacity;
+	int count;
+	unsigned long long clock;
+	pthread_mutex_t lock;
+} ProgramCache;
+
+void initProgramCache(ProgramCache* cache, int capacity);
+void freeProgramCache(ProgramCache* cache);
+
+//both return NULL on a miss, otherwise the program must be given back with releaseProgramCache()
+//a NULL source finds by the hash alone, otherwise the source must match too
+CachedProgram* findProgramCache(ProgramCache* cache, unsigned long long hash, const char* source, int length);
+//the source is copied, and a different source cached under the same hash is replaced
+CachedProgram* insertProgramCache(ProgramCache* cache, unsigned long long hash, const char* source, int length, Program* program);
+void releaseProgramCache(ProgramCache* cache, CachedProgram* entry);
+
+//serve forever on this socket path, with this many workers (0 to match the processors), returns only if the socket can't be opened
+//the time limit is enforced by a watchdog, so the workers never read the clock
+int runServer(const char* path, int jobs, int cacheSize, int optimize, InterpreterLimits* limits);
@@ -0,0 +1,121 @@
+#include "session.h"
+
+#include "parser.h"
+
+#define SESSION_RECYCLE 1024 //literals a stream can cache before they're thrown away
+
+void initSession(Session* session) {
+	initCompiler(&session->compiler);
+	session->optimize = 1;
+
+	//there is no bytecode to load, the code arrives piece by piece
+	initInterpreter(&session->interpreter, NULL, 0);
+	session->interpreter.loaded = true;
+}
+
+void freeSession(Session* session) {
+	freeInterpreter(&session->interpreter);
+	freeCompiler(&session->compiler);
+}
+
+bool runSession(Session* session, char* source) {
+	Lexer lexer;
+	Parser parser;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	parser.optimize = session->optimize;
+
+	//compile everything before running anything, so a bad piece has no effect
+	if (session->optimize == 0) {
+		//without optimizations there's no use for the nodes
+		while (!parser.error && writeParser(&parser, &session->compiler));
+	}
+	else {
+		NodeArray nodes;
+		initNodeArray(&nodes);
+
+		while(scanParser(&parser, &nodes) && !parser.error) {
+			writeCompiler(&session->compiler, &nodes);
+			clearNodeArray(&nodes);
+		}
+
+		freeNodeArray(&nodes);
+	}
+
+	if (parser.error) {
+		int size = 0;
+		flushCompiler(&session->compiler, &size); //discard the partial code
+
+		freeParser(&parser);
+		return false;
+	}
+
+	freeParser(&parser);
+
+	//execute only the new code
+	int size = 0;
+	unsigned char* code = flushCompiler(&session->compiler, &size);
+	runInterpreterCode(&session->interpreter, &session->compiler.literalCache, code, size);
+
+	return true;
+}
+
+//nothing refers to the cached literals once a statement has run, so a stream can start the caches over
+static void recycleSession(Session* session) {
+	clearLiteralArray(&session->compiler.literalCache);
+	clearLiteralIndex(&session->compiler.literalIndex);
+	clearLiteralArray(&session->interpreter.literalCache);
+}
+
+bool streamSession(Session* session, Lexer* lexer) {
+	Parser parser;
+	NodeArray nodes;
+
+	initParser(&parser, lexer);
+	parser.optimize = session->optimize;
+	initNodeArray(&nodes);
+
+	for (;;) {
+		bool more;
+
+		if (session->optimize == 0) {
+			more = writeParser(&parser, &session->compiler);
+		}
+		else {
+			more = scanParser(&parser, &nodes);
+
+			if (more && !parser.error) {
+				writeCompiler(&session->compiler, &nodes);
+			}
+
+			clearNodeArray(&nodes);
+		}
+
+		int size = 0;
+		unsigned char* code = flushCompiler(&session->compiler, &size);
+
+		//the partial code of a bad statement is discarded
+		if (parser.error || !more) {
+			break;
+		}
+
+		runInterpreterCode(&session->interpreter, &session->compiler.literalCache, code, size);
+
+		if (session->interpreter.status != INTERPRETER_DONE) {
+			break;
+		}
+
+		//repeats are still deduplicated, but a stream of distinct literals doesn't keep them all
+		if (session->compiler.literalCache.count >= SESSION_RECYCLE) {
+			recycleSession(session);
+		}
+	}
+
+	bool error = parser.error;
+
+	freeNodeArray(&nodes);
+	freeParser(&parser);
+
+	return !error;
+}
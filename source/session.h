@@ -0,0 +1,24 @@
+#pragma once
+
+#include "compiler.h"
+#include "interpreter.h"
+#include "lexer.h"
+
+//DOCS: a session keeps one compiler and one interpreter alive across many pieces of source, such as the lines of the repl
+//each piece is compiled straight into code that is executed once and then discarded
+//the literal cache only ever grows between pieces, while a stream throws it away every so often, so its memory stays flat however long it runs
+typedef struct Session {
+	Compiler compiler;
+	Interpreter interpreter;
+	int optimize; //passed on to each parser, defaults to 1
+} Session;
+
+void initSession(Session* session);
+void freeSession(Session* session);
+
+//compile and execute one piece of source, returns false without executing anything if it fails to parse
+bool runSession(Session* session, char* source);
+
+//compile and execute each statement as the lexer scans it, such as from a stream, until the source ends or the interpreter stops
+//a statement runs once the first token after it arrives, returns false at a parse error, after the statements before it have run
+bool streamSession(Session* session, Lexer* lexer);
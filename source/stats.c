@@ -0,0 +1,124 @@
+#include "stats.h"
+
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static const char* phaseNames[PHASE_COUNT] = {
+	"lex",
+	"parse",
+	"compile",
+	"handoff",
+	"init",
+	"load",
+	"execute",
+};
+
+static double readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//in kilobytes, as reported by the OS
+static long readMaxResident() {
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+
+	return usage.ru_maxrss;
+}
+
+static StatsRecord totalStats(Stats* stats) {
+	StatsRecord total;
+	memset(&total, 0, sizeof(StatsRecord));
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		total.seconds += stats->records[i].seconds;
+		total.allocations += stats->records[i].allocations;
+		total.bytes += stats->records[i].bytes;
+
+		if (stats->records[i].peak > total.peak) {
+			total.peak = stats->records[i].peak;
+		}
+	}
+
+	return total;
+}
+
+//exposed functions
+void initStats(Stats* stats, bool enabled) {
+	memset(stats, 0, sizeof(Stats));
+	stats->enabled = enabled;
+	stats->active = -1;
+}
+
+void beginStats(Stats* stats, StatsPhase phase) {
+	if (!stats->enabled) {
+		return;
+	}
+
+	resetMemoryPeak();
+
+	stats->active = phase;
+	stats->snapshot = getMemoryStats();
+	stats->start = readClock();
+}
+
+void endStats(Stats* stats) {
+	if (!stats->enabled || stats->active < 0) {
+		return;
+	}
+
+	const double seconds = readClock() - stats->start;
+	const MemoryStats memory = getMemoryStats();
+	StatsRecord* record = &stats->records[stats->active];
+
+	record->seconds += seconds;
+	record->allocations += memory.allocations - stats->snapshot.allocations;
+	record->bytes += memory.bytes - stats->snapshot.bytes;
+
+	if (memory.peak > record->peak) {
+		record->peak = memory.peak;
+	}
+
+	stats->active = -1;
+}
+
+void printStats(Stats* stats, FILE* out) {
+	fprintf(out, "--stats--\n");
+	fprintf(out, "%-10s %12s %12s %14s %14s\n", "phase", "time ms", "allocations", "bytes", "peak bytes");
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		StatsRecord* record = &stats->records[i];
+		fprintf(out, "%-10s %12.3f %12llu %14llu %14lld\n", phaseNames[i], record->seconds * 1000, record->allocations, record->bytes, record->peak);
+	}
+
+	StatsRecord total = totalStats(stats);
+	fprintf(out, "%-10s %12.3f %12llu %14llu %14lld\n", "total", total.seconds * 1000, total.allocations, total.bytes, total.peak);
+
+	fprintf(out, "bytecode: %d bytes, literals: %d, instructions executed: %llu, max resident: %ld KB\n", stats->bytecodeSize, stats->literalCount, stats->instructions, readMaxResident());
+}
+
+void writeStatsJson(Stats* stats, FILE* out) {
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"phases\": {\n");
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		StatsRecord* record = &stats->records[i];
+		fprintf(out, "\t\t\"%s\": {\"seconds\": %.9f, \"allocations\": %llu, \"bytes\": %llu, \"peak_bytes\": %lld}%s\n", phaseNames[i], record->seconds, record->allocations, record->bytes, record->peak, i + 1 < PHASE_COUNT ? "," : "");
+	}
+
+	fprintf(out, "\t},\n");
+
+	StatsRecord total = totalStats(stats);
+	fprintf(out, "\t\"total\": {\"seconds\": %.9f, \"allocations\": %llu, \"bytes\": %llu, \"peak_bytes\": %lld},\n", total.seconds, total.allocations, total.bytes, total.peak);
+
+	fprintf(out, "\t\"bytecode_bytes\": %d,\n", stats->bytecodeSize);
+	fprintf(out, "\t\"literals\": %d,\n", stats->literalCount);
+	fprintf(out, "\t\"instructions\": %llu,\n", stats->instructions);
+	fprintf(out, "\t\"max_resident_kb\": %ld\n", readMaxResident());
+	fprintf(out, "}\n");
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+#include "memory.h"
+
+#include <stdio.h>
+
+//DOCS: stats break a run down into the phases of the pipeline, recording time and allocations for each
+typedef enum StatsPhase {
+	PHASE_LEX, //only when the whole source is lexed ahead of parsing
+	PHASE_PARSE, //includes lexing, unless it was done ahead, and at -O0 or in parallel compiling too
+	PHASE_COMPILE,
+	PHASE_HANDOFF, //releasing the code from the compiler as is, to execute it in the same process, and freeing the front end
+	PHASE_INIT,
+	PHASE_LOAD, //header and literal decoding, skipped when the code was handed over
+	PHASE_EXECUTE,
+	PHASE_COUNT,
+} StatsPhase;
+
+typedef struct StatsRecord {
+	double seconds;
+	unsigned long long allocations;
+	unsigned long long bytes;
+	long long peak; //highest live bytes seen during the phase
+} StatsRecord;
+
+typedef struct Stats {
+	bool enabled; //when false, every call is a no-op
+	StatsRecord records[PHASE_COUNT];
+
+	//the phase being measured
+	int active;
+	double start;
+	MemoryStats snapshot;
+
+	//filled in by the host
+	int bytecodeSize;
+	int literalCount;
+	unsigned long long instructions;
+} Stats;
+
+void initStats(Stats* stats, bool enabled);
+
+//phases can be entered any number of times, the records accumulate
+void beginStats(Stats* stats, StatsPhase phase);
+void endStats(Stats* stats);
+
+void printStats(Stats* stats, FILE* out);
+void writeStatsJson(Stats* stats, FILE* out);
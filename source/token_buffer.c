@@ -0,0 +1,175 @@
+#include "token_buffer.h"
+
+#include "memory.h"
+#include "literal.h"
+
+#include <string.h>
+
+static void pushToken(TokenBuffer* buffer, TokenType type, size_t offset, int length) {
+	if (buffer->capacity < buffer->count + 1) {
+		int oldCapacity = buffer->capacity;
+
+		buffer->capacity = GROW_CAPACITY(oldCapacity);
+		buffer->types = GROW_ARRAY(unsigned char, buffer->types, oldCapacity, buffer->capacity);
+		buffer->offsets = GROW_ARRAY(size_t, buffer->offsets, oldCapacity, buffer->capacity);
+		buffer->lengths = GROW_ARRAY(int, buffer->lengths, oldCapacity, buffer->capacity);
+	}
+
+	buffer->types[buffer->count] = type;
+	buffer->offsets[buffer->count] = offset;
+	buffer->lengths[buffer->count] = length;
+	buffer->count++;
+}
+
+//the message may be on the lexer's stack, so it's copied right away
+static void pushError(TokenBuffer* buffer, Token token) {
+	if (buffer->errorCapacity < buffer->errorCount + 1) {
+		int oldCapacity = buffer->errorCapacity;
+
+		buffer->errorCapacity = GROW_CAPACITY(oldCapacity);
+		buffer->errorMessages = GROW_ARRAY(char*, buffer->errorMessages, oldCapacity, buffer->errorCapacity);
+		buffer->errorLines = GROW_ARRAY(int, buffer->errorLines, oldCapacity, buffer->errorCapacity);
+	}
+
+	buffer->errorMessages[buffer->errorCount] = copyString(token.lexeme, token.length);
+	buffer->errorLines[buffer->errorCount] = token.line;
+
+	pushToken(buffer, TOKEN_ERROR, buffer->errorCount++, token.length);
+}
+
+void initTokenBuffer(TokenBuffer* buffer, Lexer* lexer) {
+	buffer->source = lexer->source;
+	buffer->length = lexer->length;
+	buffer->line = lexer->line;
+
+	buffer->capacity = 0;
+	buffer->count = 0;
+	buffer->types = NULL;
+	buffer->offsets = NULL;
+	buffer->lengths = NULL;
+
+	buffer->errorCapacity = 0;
+	buffer->errorCount = 0;
+	buffer->errorMessages = NULL;
+	buffer->errorLines = NULL;
+
+	buffer->indexed = false;
+	buffer->newlineCapacity = 0;
+	buffer->newlineCount = 0;
+	buffer->newlines = NULL;
+	buffer->cursor = 0;
+	buffer->position = 0;
+
+	//the lexer keeps going after an error, so the parser sees exactly what it would have
+	for (;;) {
+		Token token = scanLexer(lexer);
+
+		if (token.type == TOKEN_ERROR) {
+			pushError(buffer, token);
+			continue;
+		}
+
+		pushToken(buffer, token.type, token.lexeme - buffer->source, token.length);
+
+		if (token.type == TOKEN_EOF) {
+			break;
+		}
+	}
+}
+
+void freeTokenBuffer(TokenBuffer* buffer) {
+	for (int i = 0; i < buffer->errorCount; i++) {
+		FREE_ARRAY(char, buffer->errorMessages[i], strlen(buffer->errorMessages[i]) + 1);
+	}
+
+	FREE_ARRAY(unsigned char, buffer->types, buffer->capacity);
+	FREE_ARRAY(size_t, buffer->offsets, buffer->capacity);
+	FREE_ARRAY(int, buffer->lengths, buffer->capacity);
+	FREE_ARRAY(char*, buffer->errorMessages, buffer->errorCapacity);
+	FREE_ARRAY(int, buffer->errorLines, buffer->errorCapacity);
+	FREE_ARRAY(size_t, buffer->newlines, buffer->newlineCapacity);
+
+	buffer->capacity = 0;
+	buffer->count = 0;
+	buffer->errorCapacity = 0;
+	buffer->errorCount = 0;
+	buffer->indexed = false;
+	buffer->newlineCapacity = 0;
+	buffer->newlineCount = 0;
+}
+
+static void indexNewlines(TokenBuffer* buffer) {
+	char* end = buffer->source + buffer->length;
+
+	for (char* c = memchr(buffer->source, '\n', buffer->length); c != NULL; c = memchr(c + 1, '\n', end - c - 1)) {
+		if (buffer->newlineCapacity < buffer->newlineCount + 1) {
+			int oldCapacity = buffer->newlineCapacity;
+
+			buffer->newlineCapacity = GROW_CAPACITY(oldCapacity);
+			buffer->newlines = GROW_ARRAY(size_t, buffer->newlines, oldCapacity, buffer->newlineCapacity);
+		}
+
+		buffer->newlines[buffer->newlineCount++] = c - buffer->source;
+	}
+
+	buffer->indexed = true;
+}
+
+//the lexer counts a newline once it's past it, so this is the number of newlines before position
+static int countNewlines(TokenBuffer* buffer, size_t position) {
+	if (!buffer->indexed) {
+		indexNewlines(buffer);
+	}
+
+	if (position >= buffer->position) {
+		while (buffer->cursor < buffer->newlineCount && buffer->newlines[buffer->cursor] < position) {
+			buffer->cursor++;
+		}
+	}
+	else {
+		int low = 0;
+		int high = buffer->cursor;
+
+		while (low < high) {
+			int mid = low + (high - low) / 2;
+
+			if (buffer->newlines[mid] < position) {
+				low = mid + 1;
+			}
+			else {
+				high = mid;
+			}
+		}
+
+		buffer->cursor = low;
+	}
+
+	buffer->position = position;
+	return buffer->cursor;
+}
+
+int findTokenBufferLine(TokenBuffer* buffer, Token* token) {
+	if (token->line >= 0) {
+		return token->line;
+	}
+
+	//where the lexer was when it made the token, a string's lexeme leaves out the closing quote
+	size_t end = (token->lexeme - buffer->source) + token->length + (token->type == TOKEN_LITERAL_STRING ? 1 : 0);
+
+	return buffer->line + countNewlines(buffer, end);
+}
+
+Token readTokenBuffer(TokenBuffer* buffer, int index) {
+	if (index >= buffer->count) {
+		index = buffer->count - 1;
+	}
+
+	Token token;
+
+	token.type = buffer->types[index];
+	token.lexeme = token.type == TOKEN_ERROR ? buffer->errorMessages[buffer->offsets[index]] : buffer->source + buffer->offsets[index];
+	token.length = buffer->lengths[index];
+	token.line = token.type == TOKEN_ERROR ? buffer->errorLines[buffer->offsets[index]] : -1; //the rest are looked up only when asked for
+
+	return token;
+}
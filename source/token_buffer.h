@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+
+//DOCS: a token buffer holds every token of a source at once, so lexing can be done ahead of parsing and timed on its own
+//the tokens are stored as parallel arrays rather than as Token structs, and a Token is only rebuilt when the parser reads one
+//lines aren't stored at all, they're found from an index of the source's newlines, which is built the first time a line is asked for
+//so a token that's read back has a line of -1, unless it's an error, and a run that never asks for a line never builds the index
+typedef struct TokenBuffer {
+	char* source; //the lexer's, lexemes point into it
+	size_t length;
+	int line; //where the source starts
+
+	int capacity;
+	int count; //the last token is always TOKEN_EOF
+	unsigned char* types;
+	size_t* offsets; //of each lexeme in the source, for errors the index of its message
+	int* lengths;
+
+	//lexer errors are rare, so their messages and lines are kept aside
+	int errorCapacity;
+	int errorCount;
+	char** errorMessages;
+	int* errorLines;
+
+	//the position of every newline in the source, for looking up lines
+	bool indexed;
+	int newlineCapacity;
+	int newlineCount;
+	size_t* newlines;
+	int cursor; //newlines before the last position looked up, lookups usually move forward
+	size_t position;
+} TokenBuffer;
+
+//scans every token the lexer has left, up to and including TOKEN_EOF, the lexer can't be streaming
+void initTokenBuffer(TokenBuffer* buffer, Lexer* lexer);
+void freeTokenBuffer(TokenBuffer* buffer);
+
+//the index is clamped to the TOKEN_EOF at the end, so reading past it behaves like scanLexer()
+Token readTokenBuffer(TokenBuffer* buffer, int index);
+int findTokenBufferLine(TokenBuffer* buffer, Token* token); //the token must have been read from this buffer
@@ -0,0 +1,33 @@
+#pragma once
+
+//DOCS: the public header of libtoy, for hosts embedding the interpreter
+//
+//	Program* program = compileProgram(source, 1);
+//
+//	for (each request) {
+//		Interpreter interpreter;
+//		bindProgram(program, &interpreter);
+//		setInterpreterPrint(&interpreter, hostPrint);
+//		runInterpreter(&interpreter);
+//		freeInterpreter(&interpreter);
+//	}
+//
+//	freeProgram(program);
+//
+//DOCS: threads
+//every setting lives on the instance it affects (Lexer.verbose, Parser.optimize, Interpreter.verbose), the global command is only read by the toy executable
+//any number of threads can run their own lexers, parsers, compilers, interpreters and sessions at once, as long as no instance is shared between threads
+//a Program never changes after creation, so any number of threads can bind and run the same program at once, but it must outlive all of them
+//writeParallel() starts its own worker threads and joins them before returning, so it's as safe to call as any compile
+//print and assert callbacks are called on the thread running the interpreter, and receive no host data, so use a thread local to find the destination
+//the memory stats are per thread, and the trace writer is locked, but the sampler is process wide and can only watch one interpreter at a time
+
+#include "common.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+#include "program.h"
+#include "session.h"
+#include "parallel.h"
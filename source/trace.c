@@ -0,0 +1,126 @@
+#include "trace.h"
+
+#include "memory.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+volatile bool traceEnabled = false;
+
+static FILE* traceFile = NULL;
+static bool traceFirst = true;
+static double traceStart = 0;
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//threads are numbered in the order they first trace something
+static int traceThreads = 0;
+static _Thread_local int traceThread = 0;
+
+static double readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3; //microseconds
+}
+
+//call these with the mutex held
+static int currentThread() {
+	if (traceThread == 0) {
+		traceThread = ++traceThreads;
+	}
+
+	return traceThread;
+}
+
+static void writeEvent(const char* format, ...) {
+	va_list args;
+
+	fprintf(traceFile, traceFirst ? "\n" : ",\n");
+	traceFirst = false;
+
+	va_start(args, format);
+	vfprintf(traceFile, format, args);
+	va_end(args);
+}
+
+//exposed functions
+bool openTrace(const char* filename) {
+	pthread_mutex_lock(&traceMutex);
+
+	if (traceFile != NULL) {
+		pthread_mutex_unlock(&traceMutex);
+		return false;
+	}
+
+	traceFile = fopen(filename, "w");
+
+	if (traceFile == NULL) {
+		pthread_mutex_unlock(&traceMutex);
+		return false;
+	}
+
+	fprintf(traceFile, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	traceFirst = true;
+	traceStart = readClock();
+	traceEnabled = true;
+
+	pthread_mutex_unlock(&traceMutex);
+	return true;
+}
+
+void closeTrace() {
+	pthread_mutex_lock(&traceMutex);
+
+	if (traceFile != NULL) {
+		traceEnabled = false;
+		fprintf(traceFile, "\n]}\n");
+		fclose(traceFile);
+		traceFile = NULL;
+	}
+
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void beginTrace(const char* category, const char* name, const char* key, long long value) {
+	const double timestamp = readClock();
+
+	pthread_mutex_lock(&traceMutex);
+
+	if (traceFile != NULL) {
+		if (key != NULL) {
+			writeEvent("{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"B\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"%s\": %lld}}", name, category, timestamp - traceStart, currentThread(), key, value);
+		}
+		else {
+			writeEvent("{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"B\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", name, category, timestamp - traceStart, currentThread());
+		}
+	}
+
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void endTrace(const char* category, const char* name) {
+	const double timestamp = readClock();
+	const MemoryStats memory = getMemoryStats();
+
+	pthread_mutex_lock(&traceMutex);
+
+	if (traceFile != NULL) {
+		writeEvent("{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"E\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", name, category, timestamp - traceStart, currentThread());
+		writeEvent("{\"name\": \"memory\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"live bytes\": %lld, \"allocated bytes\": %llu}}", timestamp - traceStart, currentThread(), memory.current, memory.bytes);
+	}
+
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void counterTrace(const char* name, long long value) {
+	const double timestamp = readClock();
+
+	pthread_mutex_lock(&traceMutex);
+
+	if (traceFile != NULL) {
+		writeEvent("{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"%s\": %lld}}", name, timestamp - traceStart, currentThread(), name, value);
+	}
+
+	pthread_mutex_unlock(&traceMutex);
+}
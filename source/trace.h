@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.h"
+
+//DOCS: tracing writes Chrome/Perfetto trace events, so spans and counters from any module can be viewed on a timeline
+//every call is guarded by traceEnabled, so a disabled trace costs a single branch
+
+extern volatile bool traceEnabled;
+
+#define TRACE_BEGIN(category, name) do { if (traceEnabled) beginTrace(category, name, NULL, 0); } while(0)
+#define TRACE_BEGIN_VALUE(category, name, key, value) do { if (traceEnabled) beginTrace(category, name, key, value); } while(0)
+#define TRACE_END(category, name) do { if (traceEnabled) endTrace(category, name); } while(0)
+#define TRACE_COUNTER(name, value) do { if (traceEnabled) counterTrace(name, value); } while(0)
+
+bool openTrace(const char* filename);
+void closeTrace();
+
+//spans nest on each thread, the key and value are optional arguments shown in the viewer
+void beginTrace(const char* category, const char* name, const char* key, long long value);
+void endTrace(const char* category, const char* name); //also records the thread's memory counters
+
+void counterTrace(const char* name, long long value);
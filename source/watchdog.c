@@ -0,0 +1,116 @@
+#include "watchdog.h"
+
+#include "memory.h"
+
+#include <time.h>
+
+static double readClock() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts); //the clock the condition waits on, so setting the system time moves no deadline
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* runWatchdog(void* arg) {
+	Watchdog* watchdog = (Watchdog*)arg;
+
+	pthread_mutex_lock(&watchdog->lock);
+
+	while (watchdog->running) {
+		//preempt everything that's overdue, and find the next deadline
+		const double now = readClock();
+		double next = 0;
+
+		for (int i = 0; i < watchdog->count; i++) {
+			WatchdogEntry* entry = &watchdog->entries[i];
+
+			if (entry->deadline <= now) {
+				preemptInterpreter(entry->interpreter);
+				watchdog->entries[i--] = watchdog->entries[--watchdog->count];
+				continue;
+			}
+
+			if (next == 0 || entry->deadline < next) {
+				next = entry->deadline;
+			}
+		}
+
+		//sleep until then, or until an interpreter is added or removed
+		if (next == 0) {
+			pthread_cond_wait(&watchdog->changed, &watchdog->lock);
+			continue;
+		}
+
+		struct timespec ts;
+		ts.tv_sec = (time_t)next;
+		ts.tv_nsec = (long)((next - ts.tv_sec) * 1e9);
+
+		pthread_cond_timedwait(&watchdog->changed, &watchdog->lock, &ts);
+	}
+
+	pthread_mutex_unlock(&watchdog->lock);
+
+	return NULL;
+}
+
+void initWatchdog(Watchdog* watchdog) {
+	watchdog->entries = NULL;
+	watchdog->capacity = 0;
+	watchdog->count = 0;
+	watchdog->running = true;
+
+	pthread_mutex_init(&watchdog->lock, NULL);
+
+	//the deadlines are monotonic, so the timed wait has to be too
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&watchdog->changed, &attributes);
+	pthread_condattr_destroy(&attributes);
+	pthread_create(&watchdog->thread, NULL, runWatchdog, watchdog);
+}
+
+void freeWatchdog(Watchdog* watchdog) {
+	pthread_mutex_lock(&watchdog->lock);
+	watchdog->running = false;
+	pthread_cond_signal(&watchdog->changed);
+	pthread_mutex_unlock(&watchdog->lock);
+
+	pthread_join(watchdog->thread, NULL);
+
+	FREE_ARRAY(WatchdogEntry, watchdog->entries, watchdog->capacity);
+	watchdog->entries = NULL;
+	watchdog->capacity = 0;
+	watchdog->count = 0;
+
+	pthread_mutex_destroy(&watchdog->lock);
+	pthread_cond_destroy(&watchdog->changed);
+}
+
+void watchInterpreter(Watchdog* watchdog, Interpreter* interpreter, double seconds) {
+	pthread_mutex_lock(&watchdog->lock);
+
+	if (watchdog->capacity < watchdog->count + 1) {
+		int oldCapacity = watchdog->capacity;
+
+		watchdog->capacity = GROW_CAPACITY(oldCapacity);
+		watchdog->entries = GROW_ARRAY(WatchdogEntry, watchdog->entries, oldCapacity, watchdog->capacity);
+	}
+
+	watchdog->entries[watchdog->count++] = (WatchdogEntry){ interpreter, readClock() + seconds };
+
+	pthread_cond_signal(&watchdog->changed);
+	pthread_mutex_unlock(&watchdog->lock);
+}
+
+void unwatchInterpreter(Watchdog* watchdog, Interpreter* interpreter) {
+	pthread_mutex_lock(&watchdog->lock);
+
+	for (int i = 0; i < watchdog->count; i++) {
+		if (watchdog->entries[i].interpreter == interpreter) {
+			watchdog->entries[i] = watchdog->entries[--watchdog->count];
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&watchdog->lock);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "interpreter.h"
+
+#include <pthread.h>
+
+//DOCS: a watchdog is a thread that preempts interpreters once their time is up, so the interpreters never have to read the clock
+//an interpreter must be unwatched before it's freed, even if it was already preempted
+typedef struct WatchdogEntry {
+	Interpreter* interpreter;
+	double deadline;
+} WatchdogEntry;
+
+typedef struct Watchdog {
+	WatchdogEntry* entries;
+	int capacity;
+	int count;
+	bool running;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} Watchdog;
+
+//starts and stops the thread
+void initWatchdog(Watchdog* watchdog);
+void freeWatchdog(Watchdog* watchdog);
+
+void watchInterpreter(Watchdog* watchdog, Interpreter* interpreter, double seconds);
+void unwatchInterpreter(Watchdog* watchdog, Interpreter* interpreter);